@@ -6,12 +6,11 @@
 #include <ostream>
 #include <string>
 #include <sstream>
-#include <vector>
 #include <array>
 
 
 
-Board::Board(std::string tFEN) : mZobrist{Zobrist::getInstance()} {
+Board::Board(std::string tFEN) {
     struct PieceColor { int pieceType; int pieceColor; };
 
     static constexpr std::array<PieceColor, 128> pieceColorMap = [] {
@@ -31,15 +30,11 @@ Board::Board(std::string tFEN) : mZobrist{Zobrist::getInstance()} {
     // Parse FEN fields
     std::istringstream fenStream(tFEN);
     std::string fenPiecePlacement, fenActiveColor, fenCastlingRights, fenEpSquare;
-    int fenHalfmoveClock = 0;
+    int fenHalfmoveClock = 0, fenFullmoveNumber = 1;
 
     fenStream >> fenPiecePlacement >> fenActiveColor >> fenCastlingRights >> fenEpSquare;
     if (!(fenStream >> fenHalfmoveClock)) fenHalfmoveClock = 0;
-
-    // Initialize state
-    mStateHist.emplace_back(uint32_t(0x0));
-    std::fill(std::begin(mBitboards), std::end(mBitboards), 0ULL);
-    std::fill(std::begin(mPieceSquare), std::end(mPieceSquare), 0);
+    if (!(fenStream >> fenFullmoveNumber) || fenFullmoveNumber < 1) fenFullmoveNumber = 1;
 
     // Setup bitboards
     std::istringstream piecePlacementStream(fenPiecePlacement);
@@ -60,7 +55,10 @@ Board::Board(std::string tFEN) : mZobrist{Zobrist::getInstance()} {
             mBitboards[piece] |= squareMask;
             mBitboards[pieceColor] |= squareMask;
             mPieceSquare[squareIndex] = piece;
-            mKey ^= mZobrist.getPieceKey(pieceColor, piece, squareIndex);
+            mKey ^= Zobrist::getPieceKey(pieceColor, piece, squareIndex);
+            mMgScore  += mgPSQT[pieceColor][piece][squareIndex];
+            mEgScore  += egPSQT[pieceColor][piece][squareIndex];
+            mMaterial += phaseValue[piece];
         }
     }
 
@@ -71,61 +69,57 @@ Board::Board(std::string tFEN) : mZobrist{Zobrist::getInstance()} {
     // Side to move
     if (fenActiveColor[0] != 'w') {
         toggleSideToMove();
-        mKey ^= mZobrist.getSTMKey();
+        mKey ^= Zobrist::getSTMKey();
     }
 
     // Castling rights
     for (char c : fenCastlingRights) {
         switch (c) {
-        case 'k': mStateHist.back() |= uint32_t(1) << 2; break;
-        case 'q': mStateHist.back() |= uint32_t(1) << 4; break;
-        case 'K': mStateHist.back() |= uint32_t(1) << 1; break;
-        case 'Q': mStateHist.back() |= uint32_t(1) << 3; break;
+        case 'k': mStateHist[mStateTop] |= uint32_t(1) << 2; break;
+        case 'q': mStateHist[mStateTop] |= uint32_t(1) << 4; break;
+        case 'K': mStateHist[mStateTop] |= uint32_t(1) << 1; break;
+        case 'Q': mStateHist[mStateTop] |= uint32_t(1) << 3; break;
         }
     }
-    mKey ^= mZobrist.getCastleKey(getCastles());
+    mKey ^= Zobrist::getCastleKey(getCastles());
 
     // En passant square
     if (fenEpSquare != "-") {
         setEpSquare(fenEpSquare[0] - 'a' + 8 * (1 - getSideToMove()));
-        mKey ^= mZobrist.getEPKey(getEpSquare() % 8); 
+        mKey ^= Zobrist::getEPKey(getEpSquare() % 8); 
     }
 
-    // Halfmove clock
-    mStateHist.back() |= (fenHalfmoveClock & 0x7f) << 25;
-}
+    // Halfmove clock and game length
+    mStateHist[mStateTop] |= (fenHalfmoveClock & 0x7f) << 25;
+    mGamePly = 2 * (fenFullmoveNumber - 1) + getSideToMove();
 
-Board::Board(const Board &tOther) : 
-    mBitboards{tOther.mBitboards}, 
-    mPieceSquare(tOther.mPieceSquare),
-    mKey(tOther.mKey) ,
-    mZobrist{Zobrist::getInstance()}
-{
-    if(tOther.mStateHist.size())mStateHist.emplace_back(tOther.mStateHist.back());
+    refreshAccumulator();
 }
 
-Board &Board::operator=(const Board &tOther)
+void Board::refreshAccumulator()
 {
-    if(this != &tOther){
-        mBitboards = tOther.mBitboards;
-        mPieceSquare = tOther.mPieceSquare;
-        mKey = tOther.mKey;
-        if(tOther.mStateHist.size())mStateHist.emplace_back(tOther.mStateHist.back());
-    }
-    return *this;
+    if (!mNNUE->isEnabled()) return;
+
+    mNNUE->reset(mAccumulator);
+    for (int color = white; color <= black; color ++)
+        for (int piece = pawn; piece <= king; piece ++) {
+            uint64_t pieces = mBitboards[piece] & mBitboards[color];
+            if (pieces) do {
+                mNNUE->addPiece(mAccumulator, color, piece, bitScanForward(pieces));
+            } while (pieces &= pieces - 1);
+        }
 }
 
-
 bool Board::operator==(const Board &tOther) const
 {
     static constexpr uint32_t mask = uint32_t(0x7f) << 25 | uint32_t(0x7) << 10;
-    return (mBitboards == tOther.mBitboards) && ((mStateHist.back() & ~mask) == (tOther.mStateHist.back() & ~mask));
+    return (mBitboards == tOther.mBitboards) && ((mStateHist[mStateTop] & ~mask) == (tOther.mStateHist[tOther.mStateTop] & ~mask));
 }
 
 bool Board::operator!=(const Board &tOther) const
 {
     static constexpr uint32_t mask = uint32_t(0x7f) << 25 | uint32_t(0x7) << 10;
-    return (mBitboards != tOther.mBitboards) || ((mStateHist.back() & ~mask) != (tOther.mStateHist.back() & ~mask));
+    return (mBitboards != tOther.mBitboards) || ((mStateHist[mStateTop] & ~mask) != (tOther.mStateHist[tOther.mStateTop] & ~mask));
 }
 
 std::string Board::asString() const {
@@ -183,8 +177,8 @@ std::string Board::asString() const {
 
 void Board::makeMove(const Move &tMove)
 {
-    mKey ^= mZobrist.getCastleKey(getCastles());
-    if (getEpState()) mKey ^= mZobrist.getEPKey(getEpSquare()%8);
+    mKey ^= Zobrist::getCastleKey(getCastles());
+    if (getEpState()) mKey ^= Zobrist::getEPKey(getEpSquare()%8);
 
     int piece, captured;
     const int moveFrom = tMove.from();
@@ -214,8 +208,10 @@ void Board::makeMove(const Move &tMove)
         return a;
     }();
 
-    mStateHist.emplace_back(mStateHist.back());
-    mStateHist.back() &= stateMask[moveFrom] & stateMask[moveTo];
+    assert(mStateTop < MAX_PLY);
+    mStateHist[mStateTop + 1] = mStateHist[mStateTop] & stateMask[moveFrom] & stateMask[moveTo];
+    mStateTop ++;
+    mGamePly ++;
     incrementHMC();
     static constexpr std::array<int, 2> KCoffset = {a1, a8}; //adds eight rank values only if stm is black
     static constexpr std::array<int, 2> QCoffset = {a1, a8}; //adds eight rank values only if stm is black
@@ -300,14 +296,14 @@ void Board::makeMove(const Move &tMove)
 
     toggleSideToMove();
 
-    mKey ^= mZobrist.getCastleKey(getCastles());
-    if (getEpState()) mKey ^= mZobrist.getEPKey(getEpSquare()%8);
+    mKey ^= Zobrist::getCastleKey(getCastles());
+    if (getEpState()) mKey ^= Zobrist::getEPKey(getEpSquare()%8);
 }
 
 void Board::undoMove(const Move &tMove)
 {
-    mKey ^= mZobrist.getCastleKey(getCastles());
-    if (getEpState()) mKey ^= mZobrist.getEPKey(getEpSquare()%8);
+    mKey ^= Zobrist::getCastleKey(getCastles());
+    if (getEpState()) mKey ^= Zobrist::getEPKey(getEpSquare()%8);
 
     toggleSideToMove();
     const int moveFrom = tMove.from();
@@ -322,26 +318,26 @@ void Board::undoMove(const Move &tMove)
     switch (tMove.flag()){
     case quiet:
         piece = searchPiece(moveTo);
-        movePiece(stm, piece, moveFrom, moveTo);
+        movePiece(stm, piece, moveTo, moveFrom);
         mPieceSquare[moveFrom] = piece;
         mPieceSquare[moveTo] = 0;
         break;
     case doublePush:
-        movePiece(stm, pawn, moveFrom, moveTo);
+        movePiece(stm, pawn, moveTo, moveFrom);
         mPieceSquare[moveFrom] = pawn;
         mPieceSquare[moveTo] = 0;
         break;
     case kingCastle:
-        movePiece(stm, king, moveFrom, moveTo);
-        movePiece(stm, rook, h1 + KCoffset[stm], f1 + KCoffset[stm]); 
+        movePiece(stm, king, moveTo, moveFrom);
+        movePiece(stm, rook, f1 + KCoffset[stm], h1 + KCoffset[stm]); 
         mPieceSquare[moveFrom] = king;
         mPieceSquare[moveTo] = 0;
         mPieceSquare[h1 + KCoffset[stm]] = rook;
         mPieceSquare[f1 + KCoffset[stm]] = 0;
         break;
     case queenCastle:
-        movePiece(stm, king, moveFrom, moveTo);
-        movePiece(stm, rook, a1 + QCoffset[stm], d1 + QCoffset[stm]); 
+        movePiece(stm, king, moveTo, moveFrom);
+        movePiece(stm, rook, d1 + QCoffset[stm], a1 + QCoffset[stm]); 
         mPieceSquare[moveFrom]   = king;
         mPieceSquare[moveTo] = 0;
         mPieceSquare[a1 + QCoffset[stm]] = rook;
@@ -350,14 +346,14 @@ void Board::undoMove(const Move &tMove)
     case capture:
         piece = searchPiece(moveTo);
         captured = getCaptured();
-        movePiece(stm, piece, moveFrom, moveTo);
-        capturePiece(stm, getCaptured(), moveTo);
+        movePiece(stm, piece, moveTo, moveFrom);
+        restorePiece(stm, getCaptured(), moveTo);
         mPieceSquare[moveFrom] = piece;
         mPieceSquare[moveTo] = captured;
         break;
     case enPassant:
-        movePiece(stm, pawn, moveFrom, moveTo);
-        capturePiece(stm, pawn, moveTo + EPoffset[stm]);
+        movePiece(stm, pawn, moveTo, moveFrom);
+        restorePiece(stm, pawn, moveTo + EPoffset[stm]);
         mPieceSquare[moveFrom] = pawn;
         mPieceSquare[moveTo]   = 0;
         mPieceSquare[moveTo + EPoffset[stm]] = pawn;
@@ -366,7 +362,7 @@ void Board::undoMove(const Move &tMove)
     case bishopPromo:
     case rookPromo:
     case queenPromo:
-        promotePiece(stm, tMove.promoPiece(), moveFrom, moveTo);
+        demotePiece(stm, tMove.promoPiece(), moveFrom, moveTo);
         mPieceSquare[moveFrom] = pawn;
         mPieceSquare[moveTo]   = 0;
         break;
@@ -375,15 +371,37 @@ void Board::undoMove(const Move &tMove)
     case rookPromoCapture:
     case queenPromoCapture:
         captured = getCaptured();
-        capturePiece(stm, getCaptured(), moveTo);
-        promotePiece(stm, tMove.promoPiece(), moveFrom, moveTo);
+        restorePiece(stm, getCaptured(), moveTo);
+        demotePiece(stm, tMove.promoPiece(), moveFrom, moveTo);
         mPieceSquare[moveFrom] = pawn;
         mPieceSquare[moveTo]   = captured;
         break;
     }
 
-    mStateHist.pop_back();
+    mStateTop --;
+    mGamePly --;
+
+    mKey ^= Zobrist::getCastleKey(getCastles());
+    if (getEpState()) mKey ^= Zobrist::getEPKey(getEpSquare()%8);
+}
+
+void Board::makeNullMove()
+{
+    if (getEpState()) mKey ^= Zobrist::getEPKey(getEpSquare()%8);
+
+    static constexpr uint32_t stateMask = ~(0x1fu << 5 | 0x7u << 10 | 0x7fu << 25);
+    assert(mStateTop < MAX_PLY);
+    mStateHist[mStateTop + 1] = mStateHist[mStateTop] & stateMask;
+    mStateTop ++;
+    mGamePly ++;
+    toggleSideToMove();
+}
+
+void Board::undoNullMove()
+{
+    toggleSideToMove();
+    mStateTop --;
+    mGamePly --;
 
-    mKey ^= mZobrist.getCastleKey(getCastles());
-    if (getEpState()) mKey ^= mZobrist.getEPKey(getEpSquare()%8);
+    if (getEpState()) mKey ^= Zobrist::getEPKey(getEpSquare()%8);
 }
@@ -2,19 +2,21 @@
 
 #include <cstdint>
 #include <string>
-#include <vector>
 #include <array>
+#include <type_traits>
 #include "Move.hpp"
 #include "Zobrist.hpp"
+#include "pst.hpp"
+#include "NNUE.hpp"
 #include <cassert>
 
+// Plain position with a fixed state stack, copies are a memcpy so threads and
+// perft splits can clone it freely and the search can copy-make instead of undoing
 class Board
 {
 public:
-    Board(): mZobrist{Zobrist::getInstance()}{}
+    Board() = default;
     Board(std::string tFEN);
-    Board(const Board&);
-    Board& operator= (const Board&);
     bool operator==(const Board&) const;
     bool operator!=(const Board&) const;
     inline friend std::ostream& operator<< (std::ostream& os, const Board& cb) {return os << cb.asString();}
@@ -23,37 +25,92 @@ public:
     
     inline uint64_t getBitboard(int tPiece) const {return mBitboards[tPiece];}   
 
-    inline int  getSideToMove() const           {return mStateHist.back() & 0x1;}
-    inline int  getCastles() const              {return (mStateHist.back() >> 1) & 0xf;}
-    inline bool getShortCastle (int tSide)const {return (mStateHist.back() >> (tSide + 1)) & 0x1;}
-    inline bool getLongCastle (int tSide) const {return (mStateHist.back() >> (tSide + 3)) & 0x1;}
-    inline bool getEpState() const              {return (mStateHist.back() >> 5) & 0x01;}
-    inline int  getEpSquare() const             {return ((mStateHist.back() >> 6) & 0xf) + 24;}
-    inline int  getCaptured() const             {return (mStateHist.back() >> 10) & 0x7;}
-    inline int  getKingSquare (int tSide) const {return (mStateHist.back() >> (13 + 6 * tSide)) & 0x3f;}
-    inline int  getHMC() const                  {return (mStateHist.back() >> 25) & 0x7f;} 
-    inline int  getFMC() const                  {return (mStateHist.size() / 2);}
+    inline int  getSideToMove() const           {return mStateHist[mStateTop] & 0x1;}
+    inline int  getCastles() const              {return (mStateHist[mStateTop] >> 1) & 0xf;}
+    inline bool getShortCastle (int tSide)const {return (mStateHist[mStateTop] >> (tSide + 1)) & 0x1;}
+    inline bool getLongCastle (int tSide) const {return (mStateHist[mStateTop] >> (tSide + 3)) & 0x1;}
+    inline bool getEpState() const              {return (mStateHist[mStateTop] >> 5) & 0x01;}
+    inline int  getEpSquare() const             {return ((mStateHist[mStateTop] >> 6) & 0xf) + 24;}
+    inline int  getCaptured() const             {return (mStateHist[mStateTop] >> 10) & 0x7;}
+    inline int  getKingSquare (int tSide) const {return (mStateHist[mStateTop] >> (13 + 6 * tSide)) & 0x3f;}
+    inline int  getHMC() const                  {return (mStateHist[mStateTop] >> 25) & 0x7f;} 
+    inline int  getFMC() const                  {return 1 + mGamePly / 2;}
 
     inline uint64_t getHash() const {return mKey;}
 
+    inline int16_t getMgScore() const  {return mMgScore;}
+    inline int16_t getEgScore() const  {return mEgScore;}
+    inline int16_t getMaterial() const {return mMaterial;}
+    inline const Accumulator& getAccumulator() const {return mAccumulator;}
+
+    /**
+     * @brief Rebuilds the network accumulator from scratch, needed when the network gets enabled
+     */
+    void refreshAccumulator();
+
     void makeMove(const Move &tMove);
     void undoMove(const Move &tMove);
 
+    /**
+     * @brief Passes the turn, used by null move pruning. Clears en-passant and the
+     * half move clock so that repetitions are never matched across a null move
+     */
+    void makeNullMove();
+    void undoNullMove();
+
+    /**
+     * @brief Tells if a side has anything but pawns and king, null move is unsafe otherwise
+     */
+    inline bool hasNonPawnMaterial(int tSide) const {
+        return (mBitboards[knight] | mBitboards[bishop] | mBitboards[rook] | mBitboards[queen]) & mBitboards[tSide];
+    }
+
+    /**
+     * @brief Drops every state below the current one, moves made so far can't be undone anymore.
+     * Keeps the state stack from filling up while a game is played on the same board
+     */
+    inline void clearHistory() {
+        mStateHist[0] = mStateHist[mStateTop];
+        mStateTop = 0;
+    }
+
     inline int searchPiece(int tSquare) const {return mPieceSquare[tSquare];}
 
 private:
+    // The bitboard and key updates are XORs and undo themselves, the eval terms do not:
+    // undoMove calls movePiece with swapped squares and uses restorePiece/demotePiece
     inline void movePiece(int tSTM, int tPiece, int tFrom, int tTo){
         const uint64_t mask = 1ULL << tFrom | 1ULL << tTo;
         mBitboards[tPiece] ^= mask;
         mBitboards[tSTM]   ^= mask;
-        mKey ^= mZobrist.getPieceKey(tSTM, tPiece, tFrom);
-        mKey ^= mZobrist.getPieceKey(tSTM, tPiece, tTo);
+        mKey ^= Zobrist::getPieceKey(tSTM, tPiece, tFrom);
+        mKey ^= Zobrist::getPieceKey(tSTM, tPiece, tTo);
+        mMgScore += mgPSQT[tSTM][tPiece][tTo] - mgPSQT[tSTM][tPiece][tFrom];
+        mEgScore += egPSQT[tSTM][tPiece][tTo] - egPSQT[tSTM][tPiece][tFrom];
+        if (mNNUE->isEnabled()) {
+            mNNUE->subPiece(mAccumulator, tSTM, tPiece, tFrom);
+            mNNUE->addPiece(mAccumulator, tSTM, tPiece, tTo);
+        }
     }
     inline void capturePiece(int tSTM, int tPiece, int tSquare){
         const uint64_t mask = 1ULL << tSquare;
         mBitboards[tPiece] ^= mask;
         mBitboards[1-tSTM] ^= mask;
-        mKey ^= mZobrist.getPieceKey(1-tSTM, tPiece, tSquare);
+        mKey ^= Zobrist::getPieceKey(1-tSTM, tPiece, tSquare);
+        mMgScore  -= mgPSQT[1-tSTM][tPiece][tSquare];
+        mEgScore  -= egPSQT[1-tSTM][tPiece][tSquare];
+        mMaterial -= phaseValue[tPiece];
+        if (mNNUE->isEnabled()) mNNUE->subPiece(mAccumulator, 1-tSTM, tPiece, tSquare);
+    }
+    inline void restorePiece(int tSTM, int tPiece, int tSquare){
+        const uint64_t mask = 1ULL << tSquare;
+        mBitboards[tPiece] ^= mask;
+        mBitboards[1-tSTM] ^= mask;
+        mKey ^= Zobrist::getPieceKey(1-tSTM, tPiece, tSquare);
+        mMgScore  += mgPSQT[1-tSTM][tPiece][tSquare];
+        mEgScore  += egPSQT[1-tSTM][tPiece][tSquare];
+        mMaterial += phaseValue[tPiece];
+        if (mNNUE->isEnabled()) mNNUE->addPiece(mAccumulator, 1-tSTM, tPiece, tSquare);
     }
     inline void promotePiece(int tSTM, int tPiece, int tFrom, int tTo){
         const uint64_t maskTo = 1ULL << tTo;
@@ -61,29 +118,60 @@ private:
         mBitboards[pawn]  ^= maskFrom;
         mBitboards[tPiece] ^= maskTo;
         mBitboards[tSTM]   ^= maskFrom | maskTo;
-        mKey ^= mZobrist.getPieceKey(tSTM, pawn, tFrom);
-        mKey ^= mZobrist.getPieceKey(tSTM, tPiece, tTo);
+        mKey ^= Zobrist::getPieceKey(tSTM, pawn, tFrom);
+        mKey ^= Zobrist::getPieceKey(tSTM, tPiece, tTo);
+        mMgScore  += mgPSQT[tSTM][tPiece][tTo] - mgPSQT[tSTM][pawn][tFrom];
+        mEgScore  += egPSQT[tSTM][tPiece][tTo] - egPSQT[tSTM][pawn][tFrom];
+        mMaterial += phaseValue[tPiece] - phaseValue[pawn];
+        if (mNNUE->isEnabled()) {
+            mNNUE->subPiece(mAccumulator, tSTM, pawn, tFrom);
+            mNNUE->addPiece(mAccumulator, tSTM, tPiece, tTo);
+        }
+    }
+    inline void demotePiece(int tSTM, int tPiece, int tFrom, int tTo){
+        const uint64_t maskTo = 1ULL << tTo;
+        const uint64_t maskFrom = 1ULL << tFrom;
+        mBitboards[pawn]  ^= maskFrom;
+        mBitboards[tPiece] ^= maskTo;
+        mBitboards[tSTM]   ^= maskFrom | maskTo;
+        mKey ^= Zobrist::getPieceKey(tSTM, pawn, tFrom);
+        mKey ^= Zobrist::getPieceKey(tSTM, tPiece, tTo);
+        mMgScore  -= mgPSQT[tSTM][tPiece][tTo] - mgPSQT[tSTM][pawn][tFrom];
+        mEgScore  -= egPSQT[tSTM][tPiece][tTo] - egPSQT[tSTM][pawn][tFrom];
+        mMaterial -= phaseValue[tPiece] - phaseValue[pawn];
+        if (mNNUE->isEnabled()) {
+            mNNUE->subPiece(mAccumulator, tSTM, tPiece, tTo);
+            mNNUE->addPiece(mAccumulator, tSTM, pawn, tFrom);
+        }
     }
 
-    inline void toggleSideToMove()              {mStateHist.back() ^= 0x01; mKey ^= mZobrist.getSTMKey();}
-    inline void removeShortCastle (int tSide)   {mStateHist.back() &= ~(0x1 << (tSide + 1));}
-    inline void removeLongCastle (int tSide)    {mStateHist.back() &= ~(0x1 << (tSide + 3));}
-    inline void setEpSquare (int tSquare )      {mStateHist.back() |= (1 << 5) | ((tSquare % 24)  << 6);}
-    inline void setCaptured (int tPiece)        {mStateHist.back() |= tPiece << 10;}
+    inline void toggleSideToMove()              {mStateHist[mStateTop] ^= 0x01; mKey ^= Zobrist::getSTMKey();}
+    inline void removeShortCastle (int tSide)   {mStateHist[mStateTop] &= ~(0x1 << (tSide + 1));}
+    inline void removeLongCastle (int tSide)    {mStateHist[mStateTop] &= ~(0x1 << (tSide + 3));}
+    inline void setEpSquare (int tSquare )      {mStateHist[mStateTop] |= (1 << 5) | ((tSquare % 24)  << 6);}
+    inline void setCaptured (int tPiece)        {mStateHist[mStateTop] |= tPiece << 10;}
     inline void setKingSquare (int tSide, int tSquare) {
-                                                mStateHist.back() &= ~(0x3f << (13 + 6 * tSide));
-                                                mStateHist.back() |= tSquare  << (13 + 6 * tSide);
+                                                mStateHist[mStateTop] &= ~(0x3f << (13 + 6 * tSide));
+                                                mStateHist[mStateTop] |= tSquare  << (13 + 6 * tSide);
                                             }
-    inline void incrementHMC()                  {mStateHist.back() += 0x1 << 25;}
-    inline void resetHMC()                      {mStateHist.back() &= ~(0x7f << 25);}
+    inline void incrementHMC()                  {mStateHist[mStateTop] += 0x1 << 25;}
+    inline void resetHMC()                      {mStateHist[mStateTop] &= ~(0x7f << 25);}
 
 private:
-    std::array<uint64_t, 8> mBitboards;
-    std::array<int, 64> mPieceSquare;
-    std::vector<uint32_t> mStateHist;
+    std::array<uint64_t, 8> mBitboards {};
+    std::array<uint8_t, 64> mPieceSquare {};
+    std::array<uint32_t, MAX_PLY + 1> mStateHist {};   // enough for a search from a fresh root
+    int mStateTop = 0;
+    int mGamePly = 0;
     uint64_t mKey = 0ULL;
 
-    const Zobrist& mZobrist;
+    // Evaluation terms kept up to date by the helpers above, white positive
+    int16_t mMgScore = 0;
+    int16_t mEgScore = 0;
+    int16_t mMaterial = 0;
+    Accumulator mAccumulator {};
+
+    const NNUE* mNNUE = &NNUE::getInstance();
 
     // stateHist entries are 32 bits arranged like:
     // what i want is [srrrrEeeeecccwwwwwwbbbbbb5555555]
@@ -97,4 +185,6 @@ private:
     // then  6 bits for black king pos  [b]
     // then  7 bits for 50 move rule    [5]
     // last  3 bits for captured piece  [c]
-};
\ No newline at end of file
+};
+
+static_assert(std::is_trivially_copyable_v<Board>, "Board must stay copyable with a memcpy");
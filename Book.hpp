@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <random>
+#include <string>
+
+#include "Board.hpp"
+#include "MappedFile.hpp"
+#include "Move.hpp"
+#include "MoveGenerator.hpp"
+
+// Polyglot opening book. The .bin file is a sequence of 16 byte big-endian entries
+// (key, move, weight, learn) sorted by key, it is memory mapped and binary searched in place
+class Book
+{
+public:
+    // Deleted methods for singleton pattern
+    Book(const Book&)             =delete;
+    Book& operator=(const Book&)  =delete;
+
+    static Book& getInstance();
+
+    static constexpr size_t ENTRY_SIZE = 16;
+
+    /**
+     * @brief Maps the given book, dropping the previous one
+     *
+     * @param tPath Location of the .bin file, "<empty>" or "" to unload the book
+     * @return true if a well formed book is now loaded
+     */
+    bool load(const std::string &tPath);
+
+    inline bool isLoaded() const {return mFile.isOpen();}
+    inline size_t entries() const {return mFile.size() / ENTRY_SIZE;}
+
+    /**
+     * @brief Looks the position up in the book
+     *
+     * @param tBoard Position to play a move in
+     * @param tBestMove Whether to always play the highest weighted move instead of drawing one by weight
+     * @return Move Legal book move, an uninitialised move if the position is not in the book
+     */
+    Move probe(const Board &tBoard, bool tBestMove);
+
+    /**
+     * @brief Computes the Polyglot hash of a position, which uses its own fixed random keys
+     * and only counts the en passant file when a pawn can actually capture there
+     */
+    static uint64_t key(const Board &tBoard);
+
+private:
+    Book() : mRng{std::random_device{}()} {}
+
+    Move decode(const Board &tBoard, uint16_t tMove) const;
+
+private:
+    const MoveGenerator mGenerator;
+    MappedFile mFile;
+    std::mt19937_64 mRng;
+};
@@ -0,0 +1,288 @@
+#include "Datagen.hpp"
+#include "Move.hpp"
+#include "MoveGenerator.hpp"
+#include "MoveList.hpp"
+#include "TT.hpp"
+#include "Worker.hpp"
+#include "notation.hpp"
+#include "utils.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr int MAX_GAME_PLIES = 400;
+constexpr int WIN_SCORE = 1500;         // kept for WIN_PLIES plies in a row by the same side decides the game
+constexpr int WIN_PLIES = 4;
+constexpr int DRAW_SCORE = 10;          // kept for DRAW_PLIES plies in a row past DRAW_MIN_PLY is a draw
+constexpr int DRAW_PLIES = 10;
+constexpr int DRAW_MIN_PLY = 80;
+constexpr int MAX_OPENING_SCORE = 1000; // random openings more unbalanced than this are replayed
+constexpr size_t FLUSH_RECORDS = 4096;  // 128 KB per thread between two writes
+
+// Appends whole batches under a lock, so that records of different threads never interleave
+class RecordWriter
+{
+public:
+    explicit RecordWriter(const std::string &tPath) : mOut{tPath, std::ios::binary | std::ios::app} {}
+
+    inline bool isOpen() const {return mOut.is_open();}
+
+    void write(std::vector<PackedPosition> &tRecords) {
+        const std::lock_guard guard(mMutex);
+        mOut.write(reinterpret_cast<const char*>(tRecords.data()), std::streamsize(tRecords.size() * sizeof(PackedPosition)));
+        mOut.flush();
+        tRecords.clear();
+    }
+
+private:
+    std::ofstream mOut;
+    std::mutex mMutex;
+};
+
+// Draws that don't need a search: fifty moves, threefold repetition and bare minor pieces
+bool isDrawn(const Board &tBoard, const std::vector<uint64_t> &tGameHist)
+{
+    if (tBoard.getHMC() >= 100) return true;
+
+    int repetitions = 1;
+    const int plies = std::min(tBoard.getHMC(), int(tGameHist.size()) - 1);
+    for (int i = 2; i <= plies; i += 2)
+        if (tGameHist[tGameHist.size() - 1 - i] == tBoard.getHash() && ++ repetitions == 3) return true;
+
+    const uint64_t heavy = tBoard.getBitboard(pawn) | tBoard.getBitboard(rook) | tBoard.getBitboard(queen);
+    return !heavy && popCount(tBoard.getBitboard(knight) | tBoard.getBitboard(bishop)) <= 1;
+}
+
+}
+
+PackedPosition PackedPosition::pack(const Board &tBoard, int16_t tScore)
+{
+    PackedPosition packed {};
+    packed.occupancy = tBoard.getBitboard(white) | tBoard.getBitboard(black);
+
+    int index = 0;
+    for (uint64_t b = packed.occupancy; b; b &= b - 1, index ++) {
+        const int square = bitScanForward(b);
+        const int color = (tBoard.getBitboard(black) >> square) & 1;
+        const uint8_t code = uint8_t(color * 8 + tBoard.searchPiece(square) - pawn);
+        packed.pieces[index / 2] |= index % 2 ? code << 4 : code;
+    }
+
+    packed.score = tScore;
+    packed.result = 1;
+    packed.flags = uint8_t(tBoard.getSideToMove() | tBoard.getCastles() << 1);
+    packed.epSquare = tBoard.getEpState() ? uint8_t(tBoard.getEpSquare() + (tBoard.getSideToMove() == white ? 8 : -8)) : 64;
+    packed.halfmoveClock = uint8_t(tBoard.getHMC());
+    packed.fullmoveNumber = uint16_t(tBoard.getFMC());
+    return packed;
+}
+
+std::string PackedPosition::toFen() const
+{
+    static constexpr char pieceChars[2][6] = {{'P', 'N', 'B', 'R', 'Q', 'K'}, {'p', 'n', 'b', 'r', 'q', 'k'}};
+
+    char board[64] = {};
+    int index = 0;
+    for (uint64_t b = occupancy; b; b &= b - 1, index ++) {
+        const int code = (pieces[index / 2] >> (index % 2 ? 4 : 0)) & 0xf;
+        board[bitScanForward(b)] = pieceChars[code >> 3][code & 7];
+    }
+
+    std::ostringstream out;
+    for (int rank = 7; rank >= 0; rank --) {
+        int empty = 0;
+        for (int file = 0; file < 8; file ++) {
+            const char piece = board[rank * 8 + file];
+            if (!piece) {
+                empty ++;
+                continue;
+            }
+            if (empty) out << empty;
+            empty = 0;
+            out << piece;
+        }
+        if (empty) out << empty;
+        if (rank) out << '/';
+    }
+
+    // Castling bits follow Board: white short, black short, white long, black long
+    std::string castles;
+    if (flags & 0x02) castles += 'K';
+    if (flags & 0x08) castles += 'Q';
+    if (flags & 0x04) castles += 'k';
+    if (flags & 0x10) castles += 'q';
+
+    out << ' ' << (flags & 1 ? 'b' : 'w') << ' ' << (castles.empty() ? "-" : castles) << ' ';
+    if (epSquare < 64) out << char('a' + epSquare % 8) << char('1' + epSquare / 8);
+    else out << '-';
+    out << ' ' << int(halfmoveClock) << ' ' << fullmoveNumber;
+    return out.str();
+}
+
+void DatagenConfig::parse(std::istream &tIss)
+{
+    std::string name;
+    while (tIss >> name) {
+        if      (name == "games")   tIss >> games;
+        else if (name == "threads") tIss >> threads;
+        else if (name == "nodes")   tIss >> nodes;
+        else if (name == "depth")   tIss >> depth;
+        else if (name == "random")  tIss >> randomPlies;
+        else if (name == "hash")    tIss >> hash;
+        else if (name == "seed")    tIss >> seed;
+        else if (name == "out")     tIss >> out;
+        else {
+            std::string value;
+            tIss >> value;
+            std::cout << "info string unknown datagen option " << name << std::endl;
+        }
+    }
+    threads = std::max(threads, 1);
+    hash = std::max(hash, 1);
+}
+
+uint64_t Datagen::run()
+{
+    RecordWriter writer(mConfig.out);
+    if (!writer.isOpen()) {
+        std::cout << "info string could not open " << mConfig.out << std::endl;
+        return 0;
+    }
+
+    const uint64_t seed = mConfig.seed ? mConfig.seed : std::random_device{}();
+    std::atomic<int> nextGame = 0, finishedGames = 0, finishedThreads = 0;
+    std::atomic<uint64_t> positions = 0;
+
+    auto play = [&](int tId) {
+        const MoveGenerator generator;
+        std::mt19937_64 rng(seed + uint64_t(tId) * 0x9E3779B97F4A7C15ULL);
+        TT tt(size_t(mConfig.hash));
+        const std::atomic<bool> goSearch = true;
+        std::vector<std::unique_ptr<Worker>> pool;
+        pool.emplace_back(std::make_unique<Worker>(0, tt, goSearch, pool));
+        Worker &worker = *pool[0];
+        worker.setSilent(true);
+
+        SearchLimits limits;
+        limits.nodes = mConfig.depth ? 0 : mConfig.nodes;
+        limits.depth = mConfig.depth;
+        const int maxDepth = mConfig.depth ? std::min(mConfig.depth, MAX_DEPTH) : MAX_DEPTH;
+
+        std::vector<PackedPosition> buffer, game;
+        buffer.reserve(FLUSH_RECORDS + MAX_GAME_PLIES);
+        std::vector<uint64_t> gameHist;
+        MoveList moves;
+
+        auto search = [&](const Board &tBoard) {
+            tt.newSearch();
+            worker.setPos(tBoard, gameHist);
+            limits.timestart = now();
+            worker.iterate(maxDepth, limits);
+        };
+
+        while (nextGame.fetch_add(1) < mConfig.games) {
+            tt.clear();
+            worker.clearHistory();
+            game.clear();
+
+            // Random opening, replayed until it leaves a playable and roughly balanced position
+            Board board(STARTPOS);
+            while (true) {
+                board = Board(STARTPOS);
+                gameHist.assign(1, board.getHash());
+                for (int ply = 0; ply < mConfig.randomPlies; ply ++) {
+                    moves.clear();
+                    generator.legal(board, moves);
+                    if (moves.empty()) break;
+                    board.makeMove(moves[std::uniform_int_distribution<size_t>(0, moves.size() - 1)(rng)]);
+                    board.clearHistory();
+                    gameHist.push_back(board.getHash());
+                }
+                moves.clear();
+                generator.legal(board, moves);
+                if (moves.empty() || isDrawn(board, gameHist)) continue;
+                search(board);
+                if (std::abs(worker.getScore()) <= MAX_OPENING_SCORE) break;
+            }
+
+            uint8_t result = 1;
+            int winPlies = 0, lossPlies = 0, drawPlies = 0;
+            for (int ply = 0; ply < MAX_GAME_PLIES; ply ++) {
+                moves.clear();
+                generator.legal(board, moves);
+                const int stm = board.getSideToMove();
+                const bool inCheck = generator.isAttacked(board, board.getKingSquare(stm), 1 - stm);
+                if (moves.empty()) {
+                    result = inCheck ? (stm == white ? 0 : 2) : 1;
+                    break;
+                }
+                if (isDrawn(board, gameHist)) break;
+
+                if (ply) search(board);
+                const Move best = worker.getBestMove();
+                const int score = stm == white ? worker.getScore() : -worker.getScore();
+                if (!best.isInit()) break;
+
+                // Adjudication on scores both sides agree with
+                winPlies  = score >=  WIN_SCORE ? winPlies + 1 : 0;
+                lossPlies = score <= -WIN_SCORE ? lossPlies + 1 : 0;
+                drawPlies = std::abs(score) <= DRAW_SCORE ? drawPlies + 1 : 0;
+                if (winPlies >= WIN_PLIES || lossPlies >= WIN_PLIES) {
+                    result = winPlies ? 2 : 0;
+                    break;
+                }
+                if (drawPlies >= DRAW_PLIES && int(gameHist.size()) > DRAW_MIN_PLY) break;
+
+                // Only quiet positions are kept, the static eval can't be fitted to scores of tactical ones
+                if (!inCheck && !best.isCapture() && !best.isPromo() && std::abs(score) < WIN_SCORE)
+                    game.push_back(PackedPosition::pack(board, int16_t(score)));
+
+                board.makeMove(best);
+                board.clearHistory();
+                gameHist.push_back(board.getHash());
+            }
+
+            for (PackedPosition &position : game) position.result = result;
+            buffer.insert(buffer.end(), game.begin(), game.end());
+            positions += game.size();
+            finishedGames ++;
+            if (buffer.size() >= FLUSH_RECORDS) writer.write(buffer);
+        }
+
+        writer.write(buffer);
+        finishedThreads ++;
+    };
+
+    const TimePoint start = now();
+    std::vector<std::thread> threads;
+    for (int id = 0; id < mConfig.threads; id ++) threads.emplace_back(play, id);
+
+    auto report = [&] {
+        const TimePoint elapsed = std::max(now() - start, TimePoint(1));
+        std::cout << "info string games " << finishedGames << "/" << mConfig.games << " positions " << positions
+                  << " time " << elapsed << " positions/hour " << positions * 3600000 / elapsed << std::endl;
+    };
+
+    TimePoint lastReport = start;
+    while (finishedThreads < mConfig.threads) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        if (now() - lastReport >= 10000) {
+            report();
+            lastReport = now();
+        }
+    }
+    for (auto &thread : threads) thread.join();
+    report();
+
+    return positions;
+}
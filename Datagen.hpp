@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <string>
+
+#include "Board.hpp"
+
+// Training record of one position, 32 bytes in host byte order. Pieces are listed in square order
+// as 4-bit codes, color * 8 + piece - pawn, the first one in the low nibble
+struct PackedPosition
+{
+    uint64_t occupancy;
+    uint8_t pieces[16];
+    int16_t score;          // search score from white's point of view
+    uint8_t result;         // game outcome for white: 0 loss, 1 draw, 2 win
+    uint8_t flags;          // side to move in bit 0, castling rights as per Board::getCastles in bits 1-4
+    uint8_t epSquare;       // en passant target square, 64 if none
+    uint8_t halfmoveClock;
+    uint16_t fullmoveNumber;
+
+    static PackedPosition pack(const Board &tBoard, int16_t tScore);
+    std::string toFen() const;
+};
+static_assert(sizeof(PackedPosition) == 32, "PackedPosition must stay 32 bytes");
+
+// Self-play settings, every field can be given as "<name> <value>" on the command line
+struct DatagenConfig
+{
+    int games = 100;            // games to play in total
+    int threads = 1;            // games played concurrently, each with its own search and hash table
+    uint64_t nodes = 5000;      // node limit of every search
+    int depth = 0;              // depth limit of every search, used instead of nodes when set
+    int randomPlies = 8;        // uniformly random moves that open every game
+    int hash = 16;              // hash table size of every thread in MB
+    uint64_t seed = 0;          // 0 draws one from the system
+    std::string out = "data.bin";
+
+    /**
+     * @brief Reads "<name> <value>" pairs until the end of the stream, unknown pairs are reported and skipped
+     */
+    void parse(std::istream &tIss);
+};
+
+class Datagen
+{
+public:
+    explicit Datagen(const DatagenConfig &tConfig) : mConfig{tConfig} {}
+
+    /**
+     * @brief Plays every game and appends the quiet positions of each one to the output file
+     *
+     * @return uint64_t Number of positions written
+     */
+    uint64_t run();
+
+private:
+    DatagenConfig mConfig;
+};
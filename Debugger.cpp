@@ -1,53 +1,102 @@
 #include "Debugger.hpp"
+#include "notation.hpp"
+#include "utils.hpp"
+#include <algorithm>
+#include <iostream>
+#include <thread>
+#include <vector>
 
-uint64_t Debugger::getPerft(int tDepth)
+void Debugger::allocate(size_t tHashMB)
 {
-    uint64_t nodes = 0;
+    mSize = tHashMB * 1024 * 1024 / sizeof(PerftEntry);
+    mTable = std::make_unique<PerftEntry[]>(mSize);
+    for (size_t i = 0; i < mSize; i ++) {
+        mTable[i].check.store(0, std::memory_order_relaxed);
+        mTable[i].data.store(0, std::memory_order_relaxed);
+    }
+}
+
+bool Debugger::probe(uint64_t tKey, int tDepth, uint64_t &outNodes) const
+{
+    const PerftEntry &entry = mTable[mulHi64(depthKey(tKey, tDepth), mSize)];
+    const uint64_t data = entry.data.load(std::memory_order_relaxed);
+    if ((entry.check.load(std::memory_order_relaxed) ^ data) != tKey || int(data & 0xff) != tDepth) return false;
+    outNodes = data >> 8;
+    return true;
+}
+
+void Debugger::insert(uint64_t tKey, int tDepth, uint64_t tNodes)
+{
+    PerftEntry &entry = mTable[mulHi64(depthKey(tKey, tDepth), mSize)];
+    const uint64_t data = tNodes << 8 | uint64_t(tDepth);
+    entry.check.store(tKey ^ data, std::memory_order_relaxed);
+    entry.data.store(data, std::memory_order_relaxed);
+}
 
-    if (tDepth == 0) 
-        return 1ULL;
+uint64_t Debugger::getPerft(int tDepth, int tThreads, bool tDivide, bool tCopyMake)
+{
+    if (tDepth == 0) return 1ULL;
 
-    std::vector<Move> moveList;
-    moveList.reserve(256);
-    if(isCheck()) mMoveGenerator.evasions(mBoard, moveList);
-    else mMoveGenerator.all(mBoard, moveList);
+    MoveList rootMoves;
+    mMoveGenerator.legal(mBoard, rootMoves);
 
-    for (auto move : moveList) {
-        mBoard.makeMove(move);
-        if(!isInCheck()){
-            nodes += getPerft(tDepth - 1);
+    std::vector<uint64_t> rootNodes(rootMoves.size(), 0);
+    std::atomic<size_t> nextMove = 0;
+
+    // Every thread keeps picking the next unsearched root move and clones the root for it
+    auto work = [&] {
+        std::vector<MoveList> lists(tDepth);
+
+        for (size_t i = nextMove++; i < rootMoves.size(); i = nextMove++) {
+            Board child = mBoard;
+            child.makeMove(rootMoves[i]);
+            rootNodes[i] = tCopyMake ? perft<true>(child, lists.data(), tDepth - 1)
+                                     : perft<false>(child, lists.data(), tDepth - 1);
         }
-        mBoard.undoMove(move);
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 1; i < tThreads; i ++) threads.emplace_back(work);
+    work();
+    for (auto &thread : threads) thread.join();
+
+    uint64_t nodes = 0;
+    for (size_t i = 0; i < rootMoves.size(); i ++) {
+        if (tDivide && rootNodes[i]) std::cout << rootMoves[i] << ": " << rootNodes[i] << std::endl;
+        nodes += rootNodes[i];
     }
     return nodes;
 }
 
-
-bool Debugger::isInCheck()
+template <bool tCopyMake>
+uint64_t Debugger::perft(Board &tBoard, MoveList *tLists, int tDepth)
 {
-    int sideToMove = mBoard.getSideToMove();
-    int kingSquare = mBoard.getKingSquare(1 - sideToMove);
-    return isSqAttacked(kingSquare, sideToMove);
-}
+    if (tDepth == 0) return 1ULL;
 
-bool Debugger::isCheck()
-{
-    int sideToMove = mBoard.getSideToMove();
-    int kingSquare = mBoard.getKingSquare( sideToMove);
-    return isSqAttacked(kingSquare, 1 - sideToMove);
-}
+    uint64_t nodes = 0;
+    const uint64_t key = tBoard.getHash();
+    if (tDepth > 1 && probe(key, tDepth, nodes)) return nodes;
 
-bool Debugger::isSqAttacked(int tSquare, int tAttackingSide)
-{    
-    uint64_t occupied = mBoard.getBitboard(white) | mBoard.getBitboard(black);
-    uint64_t pawnsSet = mBoard.getBitboard(pawn) & mBoard.getBitboard(tAttackingSide);
-    if ((mLookup.pawnAttacks(tSquare, 1-tAttackingSide) & pawnsSet) != 0) return true;
+    MoveList &moveList = *tLists;
+    moveList.clear();
+    mMoveGenerator.legal(tBoard, moveList);
 
+    // bulk counting, every generated move is legal so the last ply is never made
+    if (tDepth == 1) return moveList.size();
 
-    for (int piece = knight; piece <= king; piece ++){
-        uint64_t pieceSet = mBoard.getBitboard(piece) & mBoard.getBitboard(tAttackingSide);
-        if((mLookup.getAttacks(piece, tSquare, occupied) & pieceSet) != 0) return true;
-    } 
+    for (auto move : moveList) {
+        if constexpr (tCopyMake) {
+            Board child = tBoard;
+            child.makeMove(move);
+            nodes += perft<true>(child, tLists + 1, tDepth - 1);
+        }
+        else {
+            tBoard.makeMove(move);
+            nodes += perft<false>(tBoard, tLists + 1, tDepth - 1);
+            tBoard.undoMove(move);
+        }
+    }
 
-    return false;
-}
\ No newline at end of file
+    if (tDepth > 1) insert(key, tDepth, nodes);
+    return nodes;
+}
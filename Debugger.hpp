@@ -1,24 +1,47 @@
 #pragma once
+#include <atomic>
 #include <cstdint>
+#include <memory>
+#include <vector>
 
 #include "Board.hpp"
 #include "MoveGenerator.hpp"
-#include "MagicBitboards.hpp"
-#include "TT.hpp"
+#include "MoveList.hpp"
 
 class Debugger
 {
 public:
-    Debugger(std::string tFEN) : mLookup{MagicBitboards::getInstance()}, mBoard{tFEN}, mTT{1} {}
-    uint64_t getPerft(int tDepth);
+    Debugger(std::string tFEN, size_t tHashMB = 16) : mBoard{tFEN} {allocate(tHashMB);}
+    Debugger(const Board &tBoard, size_t tHashMB = 16) : mBoard{tBoard} {allocate(tHashMB);}
+
+    /**
+     * @brief Counts the leaf nodes of the legal move tree, splitting the root moves among threads
+     *
+     * @param tDepth Depth of the tree
+     * @param tThreads Number of threads taking part in the count
+     * @param tDivide Prints the node count below every root move
+     * @param tCopyMake Copies the board before each move instead of undoing it
+     * @return uint64_t Total number of leaf nodes
+     */
+    uint64_t getPerft(int tDepth, int tThreads = 1, bool tDivide = false, bool tCopyMake = false);
     void changePos(std::string tFEN) {mBoard = Board(tFEN);}
 private:
-    bool isInCheck();
-    bool isCheck();
-    bool isSqAttacked(int tSquare, int tAttackingSide);
+    template <bool tCopyMake>
+    uint64_t perft(Board &tBoard, MoveList *tLists, int tDepth);
+
+    // Subtree counts keyed on position and depth, every slot is validated by
+    // storing the key xor-ed with the data so that threads never need a lock
+    struct PerftEntry {
+        std::atomic<uint64_t> check;
+        std::atomic<uint64_t> data; // [nodes:56][depth:8]
+    };
+    void allocate(size_t tHashMB);
+    bool probe(uint64_t tKey, int tDepth, uint64_t &outNodes) const;
+    void insert(uint64_t tKey, int tDepth, uint64_t tNodes);
+    static inline uint64_t depthKey(uint64_t tKey, int tDepth) {return tKey ^ (tDepth * uint64_t(0x9e3779b97f4a7c15));}
 private:
-    const MagicBitboards &mLookup;
     Board mBoard;
     MoveGenerator mMoveGenerator;
-    TT mTT;
+    std::unique_ptr<PerftEntry[]> mTable;
+    size_t mSize = 0;
 };
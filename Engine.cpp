@@ -1,9 +1,13 @@
 #include "Engine.hpp"
 #include "Board.hpp"
+#include "bench.hpp"
+#include "Book.hpp"
+#include "Debugger.hpp"
 #include "Move.hpp"
 #include "MoveGenerator.hpp"
+#include "NNUE.hpp"
+#include "Tablebases.hpp"
 #include "TT.hpp"
-#include "evaluation.hpp" 
 #include "notation.hpp"
 #include "utils.hpp"
 #include <algorithm>
@@ -13,30 +17,99 @@
 #include <stdexcept>
 #include <vector>
 
-void Engine::resizeTT(int tMBSize)
+void Engine::resizeTT(size_t tMBSize)
 {
     stopSearch();
     const std::lock_guard guard(mEngineMutex);
     mTT.resize(tMBSize);
 }
 
+void Engine::setThreads(int tThreads)
+{
+    stopSearch();
+    const std::lock_guard guard(mEngineMutex);
+    mWorkers.clear();
+    for (int id = 0; id < tThreads; id ++)
+        mWorkers.emplace_back(std::make_unique<Worker>(id, mTT, mGoSearch, mWorkers));
+    for (auto &worker : mWorkers) {
+        worker->setCopyMake(mCopyMake);
+        worker->setParams(mParams);
+    }
+}
+
+void Engine::setSearchParams(const SearchParams &tParams)
+{
+    stopSearch();
+    const std::lock_guard guard(mEngineMutex);
+    mParams = tParams;
+    for (auto &worker : mWorkers) worker->setParams(mParams);
+}
+
+void Engine::setCopyMake(bool tCopyMake)
+{
+    stopSearch();
+    const std::lock_guard guard(mEngineMutex);
+    mCopyMake = tCopyMake;
+    for (auto &worker : mWorkers) worker->setCopyMake(mCopyMake);
+}
+
+bool Engine::loadNetwork(std::string tPath)
+{
+    stopSearch();
+    const std::lock_guard guard(mEngineMutex);
+    if (!NNUE::getInstance().load(tPath)) return false;
+    mBoard.refreshAccumulator();
+    return true;
+}
+
+int Engine::setSyzygyPath(const std::string &tPaths)
+{
+    stopSearch();
+    const std::lock_guard guard(mEngineMutex);
+    return Tablebases::getInstance().init(tPaths);
+}
+
+bool Engine::loadBook(const std::string &tPath)
+{
+    stopSearch();
+    const std::lock_guard guard(mEngineMutex);
+    return Book::getInstance().load(tPath);
+}
+
+bool Engine::useNNUE(bool tEnabled)
+{
+    stopSearch();
+    const std::lock_guard guard(mEngineMutex);
+    const bool enabled = NNUE::getInstance().setEnabled(tEnabled);
+    mBoard.refreshAccumulator();
+    return enabled;
+}
+
 void Engine::setPos(std::string tPosition)
 {
     stopSearch();
     const std::lock_guard guard(mEngineMutex);
     mBoard = Board(tPosition);
+    mGameHist.clear();
     mGameHist.emplace_back(mBoard.getHash());
 }
 
+void Engine::newGame()
+{
+    setPos(STARTPOS);
+    const std::lock_guard guard(mEngineMutex);
+    for (auto &worker : mWorkers) worker->clearHistory();
+}
+
 void Engine::makeMove(std::string tMove)
 {
     stopSearch();
     const std::lock_guard guard(mEngineMutex);
-    std::vector<Move> moveList;
-    moveList.reserve(256);
+    MoveList moveList;
     mGenerator.all(mBoard, moveList);
     for (auto move : moveList) if (tMove == move.asString()){
         mBoard.makeMove(move);
+        mBoard.clearHistory();
         mGameHist.emplace_back(mBoard.getHash());
         return;
     }
@@ -46,9 +119,21 @@ void Engine::makeMove(std::string tMove)
 void Engine::goSearch(SearchLimits tLimits)
 {
     stopSearch();
+
+    // Book moves are played at once, no search thread is started. Analysis always searches
+    if (mOwnBook && !tLimits.infinite) {
+        const std::lock_guard guard(mEngineMutex);
+        const Move bookMove = Book::getInstance().probe(mBoard, mBookBestMove);
+        if (bookMove.isInit()) {
+            std::cout << "bestmove " << bookMove << std::endl;
+            return;
+        }
+    }
+
+    mTT.newSearch();
     mGoSearch = true;
     mLimits = tLimits;
-    int depth = tLimits.infinite ? 99 : tLimits.depth;
+    int depth = (tLimits.infinite || !tLimits.depth) ? MAX_DEPTH : std::min(tLimits.depth, MAX_DEPTH);
     mThread = std::thread(&Engine::mainSearch, this, depth);
 }
 
@@ -58,289 +143,113 @@ void Engine::stopSearch()
     if (mThread.joinable()) mThread.join();
 }
 
-void Engine::mainSearch(int tMaxDepth)
+void Engine::perft(int tDepth, bool tDivide)
 {
+    stopSearch();
     const std::lock_guard guard(mEngineMutex);
+    Debugger debugger(mBoard);
 
-    static constexpr int16_t windowSize = 50;
-    int16_t eval = 0, alpha = CHECKMATE, beta = -CHECKMATE;
-    std::vector<Move> PV;
-    Move bestmove;
-
-    mKillers.resize(tMaxDepth);
-    mGameHist.resize(tMaxDepth);
-
-    for(int depth = 0; depth <= tMaxDepth && !exitSearch(); depth ++){
-        int lowFails = 0, highFails = 0;
-
-        do {
-            // exponentially widening the aspiration window for each failed search
-            if (eval <= alpha) alpha -= windowSize * (1 << ++lowFails);
-            if (eval >= beta ) beta  += windowSize * (1 << ++highFails);
-
-            mSearchedNodes = 0;
-            auto start = std::chrono::high_resolution_clock::now();
-            eval = alphaBeta(depth, alpha, beta, PV);
-            auto stop  = std::chrono::high_resolution_clock::now(); 
-            auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(stop - start).count();
-
-            if (!exitSearch()) printSearchInfo(depth, elapsed, eval, PV);
-        } while ((eval <= alpha || eval >= beta) && !exitSearch()); 
-
+    const TimePoint start = now();
+    const uint64_t nodes = debugger.getPerft(tDepth, int(mWorkers.size()), tDivide, mCopyMake);
+    const TimePoint elapsed = now() - start;
 
-        alpha = eval - windowSize;
-        beta  = eval + windowSize;
-
-        if(PV.size() && !exitSearch()) bestmove = PV.back();
-    }
-    
-    mGoSearch = false;
-    std::cout << "bestmove " << bestmove << std::endl;
+    std::cout << "\nNodes searched: " << nodes << "\nTime: " << elapsed << " ms\nNodes/second: "
+              << (elapsed > 0 ? nodes * 1000 / elapsed : 0) << std::endl;
 }
 
-
-void Engine::printSearchInfo(int tDepth, int64_t tElapsed, int16_t tEval, std::vector<Move> &tPV)
+uint64_t Engine::bench(int tDepth, int tThreads)
 {
-    double elapsedSec = tElapsed / 1000.0;
-    uint64_t nps = (elapsedSec > 0) ? static_cast<uint64_t>(mSearchedNodes / elapsedSec) : 0;
-    
-    std::cout << "info depth " << tDepth << " nodes " << mSearchedNodes << " time " << tElapsed << " nps " << nps;
-
-    // if(eval <= CHECKMATE) std::cout << " mate " << (t_maxDepth - (CHECKMATE - eval)) / 2 + 1 << " ";
-    // else if( eval  >= -CHECKMATE) std::cout << " mate -" << (t_maxDepth - (CHECKMATE + eval)) / 2 + 1 << " ";
-    // else
-    std::cout << " score cp " << tEval;
-    
-    if (tPV.size()){
-        std::cout << " pv ";
-        for (auto move = tPV.crbegin(); move != tPV.crend(); move ++) if(move->asString() != "a1a1") std::cout << *move << " ";
-    }
-
-    std::cout << std::endl;
-}
-
-
-int16_t Engine::alphaBeta(int tDepth, int16_t tAlpha, int16_t tBeta, std::vector<Move> &tPV){ 
-    if (exitSearch() || threefoldRepetition() || fiftyMove()) return DRAW;
-    if (tDepth == 0) return quiescence(tAlpha, tBeta);  
+    stopSearch();
+    const std::lock_guard guard(mEngineMutex);
 
-    // Hash move search    
-    uint64_t hashKey = mBoard.getHash();
-    auto [ttHit, ttEntry] = mTT.probe(hashKey);
-    if( ttHit && hashUsageCondition(ttEntry, tDepth, tAlpha, tBeta)){
-        tPV.emplace_back(ttEntry.hashMove); 
-        return ttEntry.score;
+    // Workers of its own, so that neither the Threads option nor past searches change the result
+    std::vector<std::unique_ptr<Worker>> pool;
+    for (int id = 0; id < std::max(tThreads, 1); id ++) {
+        pool.emplace_back(std::make_unique<Worker>(id, mTT, mGoSearch, pool));
+        pool.back()->setCopyMake(mCopyMake);
+        pool.back()->setParams(mParams);
+        pool.back()->setSilent(id > 0);
     }
-
-    Move bestMove;
-    int16_t bestScore = CHECKMATE - tDepth; 
-    uint8_t bestNodeType = allNode;
-    std::vector<Move> line(tDepth);
-
-    mSearchedNodes +=1;
-
-    // Lambda function for searching individual moves
-    auto searchMove = [&] (Move move) {
-        mBoard.makeMove(move);
-        mGameHist.emplace_back(mBoard.getHash());
-        if(!isIllegal()){
-            int16_t score = CHECKMATE;
-            // zero-window search if alpha has already been raised
-            if (bestNodeType == pvNode)
-                score = -alphaBeta(tDepth - 1, -tAlpha - 1, -tAlpha, line);
-            // full window search if alpha hasn't been searched or move could raise alpha
-            if (bestNodeType != pvNode || (score > tAlpha && score < tBeta))
-                score = -alphaBeta(tDepth - 1, -tBeta, -tAlpha, line);
-
-            if (score > bestScore) {
-                bestScore = score;
-                bestMove = move;
-                if (bestScore > tAlpha) {
-                    bestNodeType = pvNode;
-                    tAlpha = bestScore;
-                    tPV = line;
-                    tPV.emplace_back(move);
-                }
-            }
-        }
-        mBoard.undoMove(move);
-        mGameHist.pop_back();
-    };
-
-    // Lambda function for checking if the node fails high and populating TT accordingly
-    auto failsHigh = [&] (Move move, int TTDepth){
-        if (tAlpha >= tBeta){
-            if (!exitSearch() && tDepth >= TTDepth) 
-                mTT.insert({hashKey, bestScore, uint8_t(tDepth), cutNode, bestMove});
-            if (!move.isCapture() && mKillers[tDepth-1][0] != move){
-                mKillers[tDepth-1][1] = mKillers[tDepth-1][0];
-                mKillers[tDepth-1][0] = move;
-            }
-            return true;
+    Worker &worker = *pool[0];
+
+    uint64_t nodes = 0, mainNodes = 0;
+    TimePoint elapsed = 0;
+    for (size_t i = 0; i < BENCH_POSITIONS.size(); i ++) {
+        std::cout << "\nPosition " << i + 1 << "/" << BENCH_POSITIONS.size() << ": " << BENCH_POSITIONS[i] << std::endl;
+        const Board board(BENCH_POSITIONS[i]);
+        mTT.clear();
+        for (auto &helper : pool) {
+            helper->clearHistory();
+            helper->setPos(board, {board.getHash()});
         }
-        return false;
-    };
 
-    if (ttHit && mGenerator.validate(mBoard, ttEntry.hashMove)){
-        searchMove(ttEntry.hashMove);
-        if (failsHigh(ttEntry.hashMove, ttEntry.depht))
-            return bestScore;
+        SearchLimits limits;
+        limits.depth = tDepth;
+        limits.timestart = now();
+        mGoSearch = true;
+        std::vector<std::thread> helpers;
+        for (size_t id = 1; id < pool.size(); id ++)
+            helpers.emplace_back(&Worker::iterate, pool[id].get(), tDepth, limits);
+        worker.iterate(tDepth, limits);
+        mGoSearch = false;
+        for (auto &helper : helpers) helper.join();
+
+        elapsed += now() - limits.timestart;
+        for (const auto &helper : pool) nodes += helper->getSearchedNodes();
+        mainNodes += worker.getSearchedNodes();
     }
 
-    // Generating, sorting and searching captures
-    std::vector<Move> captures;
-    captures.reserve(256);
-    mGenerator.captures(mBoard, captures);
-
-    std::sort(captures.begin(), captures.end(),[&](const Move m1, const Move m2){
-        return mBoard.searchPiece(m1.from()) < mBoard.searchPiece(m2.from());
-    });
-    std::stable_sort(captures.begin(), captures.end(),[&](const Move m1, const Move m2){
-        return mBoard.searchPiece(m1.to()) > mBoard.searchPiece(m2.to());
-    });
-    
-    for(Move move : captures){
-        searchMove(move);
-        if(failsHigh(move, ttEntry.depht))
-            return bestScore;
-    }
-
-    // Generating, sorting and searching quiets
-    std::vector<Move> quiets;
-    quiets.reserve(256);
-    mGenerator.quiets(mBoard, quiets);
-
-    std::partition(quiets.begin(), quiets.end(), [&](const Move m){
-        return m == mKillers[tDepth-1][0] || m == mKillers[tDepth-1][1];
-    });
-
-    for (Move move : quiets){
-        searchMove(move);
-        if(failsHigh(move, ttEntry.depht))
-            return bestScore;
-    }
-
-    if(!exitSearch() && tDepth >= ttEntry.depht){
-        if (bestScore == CHECKMATE - tDepth && !isCheck()) bestScore = DRAW;
-        mTT.insert({hashKey, bestScore, uint8_t(tDepth), bestNodeType, bestMove});
-    }
-    
-    return bestScore;
+    std::cout << "\n===========================\nTotal time (ms) : " << elapsed << "\nNodes searched  : " << nodes
+              << "\nNodes/second    : " << (elapsed > 0 ? nodes * 1000 / elapsed : 0) << std::endl;
+    // With one core per thread the time-to-depth follows the main thread, not the pool total
+    if (pool.size() > 1) std::cout << "Main thread     : " << mainNodes << std::endl;
+    return nodes;
 }
 
-int16_t Engine::quiescence(int16_t tAlpha, int16_t tBeta)
-{    
-    mSearchedNodes += 1;
-
-    static constexpr int16_t pieceVal[7] = {0, 0, 100, 300, 300, 500, 1000}; 
-    int16_t standPat = evaluate(mBoard);
-    int16_t bestScore;
-    std::vector<Move> moveList;
-    moveList.reserve(256);
-
-    if (isCheck()){
-        bestScore = CHECKMATE;
-        mGenerator.evasions(mBoard, moveList);
-    }
-    else{
-        bestScore = standPat;
-        if(bestScore > tAlpha) {
-            tAlpha = bestScore; 
-            if(tAlpha >= tBeta) return bestScore;
-        }
-        else if(bestScore + (promoThreat() ? 1800 : 1000) < tAlpha) 
-            return bestScore;
-
-        mGenerator.captures(mBoard, moveList);
-        std::sort(moveList.begin(), moveList.end(), [this](const Move& m1, const Move& m2){
-            return mBoard.searchPiece(m1.from()) < mBoard.searchPiece(m2.from());
-        });
-        std::stable_sort(moveList.begin(), moveList.end(), [this](const Move& m1, const Move& m2){
-            return mBoard.searchPiece(m1.to()) > mBoard.searchPiece(m2.to());
-        });
-    }
-
-    for (const auto& move : moveList){
-        mBoard.makeMove(move);
-            if(!isIllegal() && standPat + pieceVal[mBoard.getCaptured()] + 200 > tAlpha){ 
-            int16_t score = -quiescence(-tBeta, -tAlpha);
-            
-            if (score > bestScore) {
-                bestScore = score; 
-                if (bestScore > tAlpha) tAlpha = bestScore;
-            }
-        }
-        mBoard.undoMove(move);
+void Engine::mainSearch(int tMaxDepth)
+{
+    const std::lock_guard guard(mEngineMutex);
 
-        if(tAlpha >= tBeta) return bestScore;
+    // With the root in the tablebases only the moves keeping its outcome are searched
+    MoveList rootMoves;
+    Tablebases &tablebases = Tablebases::getInstance();
+    if (tablebases.canProbe(mBoard)) {
+        Board root = mBoard;
+        root.clearHistory();
+        mGenerator.legal(root, rootMoves);
+        const int plies = std::min(root.getHMC(), int(mGameHist.size()) - 1);
+        const bool repeated = std::find(mGameHist.end() - 1 - plies, mGameHist.end() - 1, root.getHash()) != mGameHist.end() - 1;
+        if (!tablebases.filterRootMoves(root, repeated, rootMoves)) rootMoves.clear();
     }
 
-    return bestScore;
-}
+    for (auto &worker : mWorkers) worker->setPos(mBoard, mGameHist, rootMoves);
 
-bool Engine::isIllegal()
-{
-    const int stm = mBoard.getSideToMove();
-    const int kingSquare = mBoard.getKingSquare(1 - stm);
-    return mGenerator.isAttacked(mBoard, kingSquare, stm);
-}
+    // Lazy SMP: helpers search the same root sharing only the TT, the main thread
+    // checks the limits and stops them as soon as its own iterations are over.
+    // Helpers run every iteration, on "bench 9 <threads>" skipping some of them
+    // made the main thread need more nodes to reach the same depth
+    std::vector<std::thread> helpers;
+    for (size_t id = 1; id < mWorkers.size(); id ++)
+        helpers.emplace_back(&Worker::iterate, mWorkers[id].get(), tMaxDepth, mLimits);
 
-bool Engine::isCheck()
-{
-    const int stm = mBoard.getSideToMove();
-    const int kingSquare = mBoard.getKingSquare(stm);
-    return mGenerator.isAttacked(mBoard, kingSquare, 1 - stm);
-}
+    mWorkers[0]->iterate(tMaxDepth, mLimits);
 
-bool Engine::promoThreat()
-{
-    static constexpr uint64_t seventhRank[2] = {uint64_t(0x00ff000000000000), uint64_t(0x000000000000ff00)};
-    const int stm = mBoard.getSideToMove();
-    return mBoard.getBitboard(pawn) & mBoard.getBitboard(stm) & seventhRank[stm];
-}
+    mGoSearch = false;
+    for (auto &helper : helpers) helper.join();
 
-bool Engine::hashUsageCondition(TTEntry tTTVal, int tDepht, int tAlpha, int tBeta)
-{
-    return tTTVal.depht >= tDepht && (
-            (tTTVal.nodeType == pvNode)
-            || (tTTVal.nodeType == allNode && tTTVal.score <= tAlpha)
-            || (tTTVal.nodeType == cutNode && tTTVal.score >= tBeta )
-        );
+    std::cout << "bestmove " << bestWorker().getBestMove() << std::endl;
 }
 
-bool Engine::threefoldRepetition()
+const Worker &Engine::bestWorker() const
 {
-    int repetition = 1;
-    const int revPlies = mBoard.getHMC(); // number of plies with reversible moves
-    const int histSize = mGameHist.size(); // lenght of current game
-    const int maxPlies = std::min(histSize, revPlies);
-    
-    if (maxPlies < 8) return false; // not enough reversible moves for threefold rep 
-    for (int ply = 2; ply <= maxPlies; ply += 2){ // checks every even spaced key for repetition (excluding the second last)
-        if(mGameHist[(histSize - 1) - ply] ==  mGameHist.back()) {
-            repetition += 1;
-            if(repetition == 3) return true;
-        }
+    // Prefers the deepest completed iteration, then the best score among equally deep ones
+    const Worker *best = mWorkers[0].get();
+    for (const auto &worker : mWorkers) {
+        if (!worker->getBestMove().isInit()) continue;
+        if (!best->getBestMove().isInit()
+            || worker->getCompletedDepth() > best->getCompletedDepth()
+            || (worker->getCompletedDepth() == best->getCompletedDepth() && worker->getScore() > best->getScore()))
+            best = worker.get();
     }
-    return false;
-}
-
-bool Engine::fiftyMove()
-{
-    const int revPlies = mBoard.getHMC(); // number of plies with reversible moves
-    return revPlies >= 100;
-}
-
-bool Engine::exitSearch()
-{
-    if (!mGoSearch.load()) 
-        return true;
-    else if(mLimits.infinite)
-        return false;
-    else if(mLimits.movetime)
-        return (now() - mLimits.timestart) > mLimits.movetime;
-    else if(mLimits.nodes)
-        return mSearchedNodes > mLimits.nodes;
-    else 
-        return false;
+    return *best;
 }
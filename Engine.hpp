@@ -5,79 +5,154 @@
 #include <atomic>
 #include <thread>
 #include <mutex>
+#include <memory>
 
 #include "Board.hpp"
 #include "Move.hpp"
 #include "MoveGenerator.hpp"
 #include "utils.hpp"
 #include "TT.hpp"
+#include "Worker.hpp"
 
 class Engine
 {
 public:
-    Engine(): mTT{1}, mBoard{Board(STARTPOS)} {}
+    Engine(): mTT{1}, mBoard{Board(STARTPOS)} {setThreads(1);}
     ~Engine() {stopSearch();}
 
     /**
-     * @brief Changes the transposition table size to the given dimension 
-     * 
+     * @brief Changes the transposition table size to the given dimension
+     *
      * @param sizeMB The new size in MB
      */
-    void resizeTT(int sizeMB);
+    void resizeTT(size_t sizeMB);
+
+    /**
+     * @brief Changes the number of threads taking part in the search
+     *
+     * @param tThreads Number of search threads, the first one being the main thread
+     */
+    void setThreads(int tThreads);
+
+    /**
+     * @brief Chooses how search and perft get back to the parent position
+     *
+     * @param tCopyMake true to copy the board before each move, false to undo the move
+     */
+    void setCopyMake(bool tCopyMake);
+
+    /**
+     * @brief Replaces the selective search parameters of every worker
+     *
+     * @param tParams Parameters as per SearchParams specification
+     */
+    void setSearchParams(const SearchParams &tParams);
+    inline const SearchParams& getSearchParams() const {return mParams;}
+
+    /**
+     * @brief Loads the evaluation network from the given file
+     *
+     * @param tPath Location of the network file
+     * @return true if the network was loaded
+     */
+    bool loadNetwork(std::string tPath);
+
+    /**
+     * @brief Switches between network and PST evaluation
+     *
+     * @param tEnabled Whether to evaluate with the network
+     * @return true if the network is in use
+     */
+    bool useNNUE(bool tEnabled);
+
+    /**
+     * @brief Looks for Syzygy tablebases in the given directories
+     *
+     * @param tPaths Directories separated by ':' (';' on Windows), "<empty>" to disable probing
+     * @return int Number of tables found
+     */
+    int setSyzygyPath(const std::string &tPaths);
+
+    /**
+     * @brief Loads a Polyglot opening book
+     *
+     * @param tPath Location of the .bin file, "<empty>" to unload the book
+     * @return true if the book was loaded
+     */
+    bool loadBook(const std::string &tPath);
+
+    // Book moves are played instead of searching, drawn by weight unless the best one is asked for.
+    // Both are only read by goSearch, on the same thread that sets them
+    inline void setOwnBook(bool tEnabled)      {mOwnBook = tEnabled;}
+    inline void setBookBestMove(bool tBestMove) {mBookBestMove = tBestMove;}
 
     /**
      * @brief Sets the starting position to the given one
-     * 
+     *
      * @param tPosition FEN for the desired starting position
      */
     void setPos(std::string tPosition);
 
+    /**
+     * @brief Goes back to the starting position and forgets the move ordering history of the previous game
+     */
+    void newGame();
+
     /**
      * @brief Updates the starting position
-     * 
+     *
      * @param tMove Legal move to make from the starting position
      */
     void makeMove(std::string tMove);
 
     /**
      * @brief Starts the search
-     * 
+     *
      * @param tLimits Search parameters as per SearchLimits specification
      */
     void goSearch(SearchLimits tLimits);
-    
+
     /**
      * @brief Interrupts the search ASAP
      */
-    void stopSearch();    
+    void stopSearch();
 
-private:
-    void mainSearch(int tDepht);
-    bool exitSearch();
-    
-    void printSearchInfo(int tMaxDepth, int64_t tElapsed, int16_t tEval, std::vector<Move> &tPV);
-    int16_t alphaBeta(int tDepht, int16_t tAlpha, int16_t tBeta, std::vector<Move> &tPV);
-    int16_t quiescence(int16_t tAlpha, int16_t tBeta);
+    /**
+     * @brief Counts the leaf nodes of the move tree from the current position and reports nodes/s
+     *
+     * @param tDepth Depth of the tree
+     * @param tDivide Also prints the count below every root move
+     */
+    void perft(int tDepth, bool tDivide);
 
-    bool isIllegal(); // opponent side is in check but its not his turn
-    bool isCheck();   // opponent side gives check and its your turn
-    bool promoThreat();
+    /**
+     * @brief Searches every bench position at a fixed depth, with TT and history cleared before each one,
+     * and reports the total. On a single thread the node count only depends on the code, the depth and the
+     * hash size; with more threads the total time is the Lazy SMP time-to-depth
+     *
+     * @param tDepth Search depth of every position
+     * @param tThreads Workers searching each position, the first one sets the depth reached
+     * @return uint64_t Total nodes searched, the bench signature on one thread
+     */
+    uint64_t bench(int tDepth, int tThreads = 1);
 
-    bool hashUsageCondition(TTEntry tTTVal, int tDepht, int tAlpha, int tBeta);
-    bool threefoldRepetition();
-    bool fiftyMove();
+private:
+    void mainSearch(int tDepht);
+    const Worker& bestWorker() const;
 
 private:
     const MoveGenerator mGenerator;
-    std::vector<std::array<Move, 2>> mKillers;
     std::vector<uint64_t> mGameHist;
     TT mTT;
     Board mBoard;
-    uint64_t mSearchedNodes;
     SearchLimits mLimits;
+    std::vector<std::unique_ptr<Worker>> mWorkers;
+    bool mCopyMake = false;
+    bool mOwnBook = false;
+    bool mBookBestMove = false;
+    SearchParams mParams;
 
     std::atomic<bool> mGoSearch = false;
     std::thread mThread;
     std::mutex mEngineMutex;
 };
-
@@ -0,0 +1,22 @@
+#include "History.hpp"
+#include <algorithm>
+
+void History::clear()
+{
+    for (auto &side : mButterfly) for (auto &from : side) from.fill(0);
+    mCounters.fill(Move());
+    for (auto &cont : mContinuation) cont.fill(0);
+}
+
+void History::age()
+{
+    for (auto &side : mButterfly) for (auto &from : side) for (int16_t &entry : from) entry /= 2;
+    for (auto &cont : mContinuation) for (int16_t &entry : cont) entry /= 2;
+}
+
+void History::update(int tSide, Move tMove, int tPieceTo, const std::array<ContTable*, 2> &tCont, int tBonus)
+{
+    tBonus = std::clamp(tBonus, -MAX_SCORE, MAX_SCORE);
+    gravity(mButterfly[tSide][tMove.from()][tMove.to()], tBonus);
+    for (ContTable *cont : tCont) if (cont) gravity((*cont)[tPieceTo], tBonus);
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+
+#include "Move.hpp"
+#include "notation.hpp"
+
+// Quiet move ordering statistics learnt from beta cutoffs: butterfly history by side and from/to squares,
+// countermoves and continuation histories indexed by the moved piece and destination of a previous move
+class History
+{
+public:
+    static constexpr int PIECE_TO = 2 * 6 * 64;
+    static constexpr int MAX_SCORE = 16384;
+
+    // Continuation history of a single previous move, indexed by the piece and destination of the current one
+    using ContTable = std::array<int16_t, PIECE_TO>;
+
+    static inline int pieceTo(int tSide, int tPiece, int tSquare) {return (tSide * 6 + tPiece - pawn) * 64 + tSquare;}
+
+    /**
+     * @brief Forgets everything, to be called on a new game
+     */
+    void clear();
+
+    /**
+     * @brief Halves every score so that a new search favours what it learns itself
+     */
+    void age();
+
+    /**
+     * @brief Ordering score of a quiet move, sum of its butterfly and continuation histories
+     *
+     * @param tSide Side making the move
+     * @param tMove Quiet move to score
+     * @param tPieceTo Piece and destination of the move as given by pieceTo()
+     * @param tCont Continuation tables of the moves played one and two plies before, nullptr if missing
+     * @return int Higher is better
+     */
+    inline int score(int tSide, Move tMove, int tPieceTo, const std::array<const ContTable*, 2> &tCont) const {
+        int score = mButterfly[tSide][tMove.from()][tMove.to()];
+        for (const ContTable *cont : tCont) if (cont) score += (*cont)[tPieceTo];
+        return score;
+    }
+
+    /**
+     * @brief Rewards or punishes a quiet move in every table, keeping scores within MAX_SCORE
+     *
+     * @param tSide Side making the move
+     * @param tMove Quiet move searched
+     * @param tPieceTo Piece and destination of the move as given by pieceTo()
+     * @param tCont Continuation tables of the moves played one and two plies before, nullptr if missing
+     * @param tBonus Positive for the move that failed high, negative for the ones searched before it
+     */
+    void update(int tSide, Move tMove, int tPieceTo, const std::array<ContTable*, 2> &tCont, int tBonus);
+
+    inline Move getCounter(int tPrevPieceTo) const              {return mCounters[tPrevPieceTo];}
+    inline void setCounter(int tPrevPieceTo, Move tMove)        {mCounters[tPrevPieceTo] = tMove;}
+    inline ContTable* continuation(int tPrevPieceTo)            {return &mContinuation[tPrevPieceTo];}
+
+private:
+    // Gravity: the closer a score is to the bounds, the less a bonus moves it
+    static inline void gravity(int16_t &tEntry, int tBonus) {
+        tEntry += tBonus - tEntry * std::abs(tBonus) / MAX_SCORE;
+    }
+
+private:
+    std::array<std::array<std::array<int16_t, 64>, 64>, 2> mButterfly {};
+    std::array<Move, PIECE_TO> mCounters {};
+    std::array<ContTable, PIECE_TO> mContinuation {};
+};
@@ -1,16 +1,24 @@
 #pragma once
 
+#include <array>
 #include <cstdint>
 #include <stdexcept>
 #include "notation.hpp"
+#include "utils.hpp"
 
+#if defined(__BMI2__) || (defined(_MSC_VER) && defined(_M_X64))
+#include <immintrin.h>
+#endif
+
+// Every table is generated at compile time and lives in read-only data,
+// the only thing decided at startup is which slider indexing to use
 class MagicBitboards{
 public:
     // Deleted methods for singleton pattern
     MagicBitboards(const MagicBitboards&)               = delete;
     MagicBitboards& operator=(const MagicBitboards&)    = delete;
 
-    static const MagicBitboards& getInstance();
+    static inline const MagicBitboards& getInstance() {return mInstance;}
 
     /**
      * @brief Returns attack pattern for pawns
@@ -19,10 +27,28 @@ public:
      * @param tSide Pawn color
      * @return uint64_t attack pattern bitboard
      */
-    constexpr uint64_t pawnAttacks(int tSquare, int tSide) const {
+    static constexpr uint64_t pawnAttacks(int tSquare, int tSide) {
         return mPawnAttacks[tSquare][tSide];
     }
 
+    /**
+     * @brief Returns attack pattern for a (non-pawn) piece known at compile time
+     * 
+     * @tparam tPiece Non-pawn piece 
+     * @param tSquare Where the piece is located
+     * @param tOccupied Position occupancy bitboard
+     * @return uint64_t attack pattern bitboard
+     */
+    template <int tPiece>
+    static inline uint64_t attacks(int tSquare, uint64_t tOccupied) {
+        static_assert(tPiece >= knight && tPiece <= king, "Input piece is invalid");
+        if constexpr (tPiece == knight) return knightAttacks(tSquare);
+        else if constexpr (tPiece == bishop) return bishopAttacks(tOccupied, tSquare);
+        else if constexpr (tPiece == rook) return rookAttacks(tOccupied, tSquare);
+        else if constexpr (tPiece == queen) return queenAttacks(tOccupied, tSquare);
+        else return kingAttacks(tSquare);
+    }
+
     /**
      * @brief Returns attack pattern for (non-pawn) pieces 
      * 
@@ -31,65 +57,315 @@ public:
      * @param tOccupied Position occupancy bitboard
      * @return uint64_t attack pattern bitboard
      */
-    constexpr uint64_t getAttacks(int tPiece, int tSquare, uint64_t tOccupied) const {
+    static inline uint64_t getAttacks(int tPiece, int tSquare, uint64_t tOccupied) {
         switch (tPiece) {
-            case knight: return knightAttacks(tSquare);
-            case bishop: return bishopAttacks(tOccupied, tSquare);
-            case rook:   return rookAttacks(tOccupied, tSquare);
-            case queen:  return queenAttacks(tOccupied, tSquare);
-            case king:   return kingAttacks(tSquare);
+            case knight: return attacks<knight>(tSquare, tOccupied);
+            case bishop: return attacks<bishop>(tSquare, tOccupied);
+            case rook:   return attacks<rook>(tSquare, tOccupied);
+            case queen:  return attacks<queen>(tSquare, tOccupied);
+            case king:   return attacks<king>(tSquare, tOccupied);
             default: throw std::invalid_argument("Input piece is invalid");
         }
     }
 
+    /**
+     * @brief Tells which backend indexes the slider tables
+     * 
+     * @return true if BMI2 PEXT is used, false for fancy magics
+     */
+    static inline bool usesPext() {return mUsePext;}
+
+    /**
+     * @brief Returns the squares strictly between two aligned squares
+     * 
+     * @param tFrom First square
+     * @param tTo Second square
+     * @return uint64_t bitboard of the squares in between, empty if not on the same line
+     */
+    static constexpr uint64_t betweenSquares(int tFrom, int tTo) {
+        return mBetween[tFrom][tTo];
+    }
+
+    /**
+     * @brief Returns the whole rank, file or diagonal going through two squares
+     * 
+     * @param tFrom First square
+     * @param tTo Second square
+     * @return uint64_t bitboard of the line, empty if the squares are not aligned
+     */
+    static constexpr uint64_t lineThrough(int tFrom, int tTo) {
+        return mLine[tFrom][tTo];
+    }
+
 private:
-    MagicBitboards();
-    ~MagicBitboards() {delete mInstance; mInstance = nullptr;}
-
-    void initRayAttacks();
-    void initKnightAttacks();
-    void initKingAttacks();
-    void initPawnAttacks();
-    void initMagicMoves();
-    
-    constexpr uint64_t rayAttacks (int tSquare, int tDirection) const {
+    constexpr MagicBitboards() = default;
+
+    using SquareTable = std::array<uint64_t, 64>;
+    using RayTable = std::array<std::array<uint64_t, 8>, 64>;
+    using PawnTable = std::array<std::array<uint64_t, 2>, 64>;
+    using PairTable = std::array<std::array<uint64_t, 64>, 64>;
+    using OffsetTable = std::array<unsigned int, 64>;
+
+    static constexpr uint64_t rayAttacks (int tSquare, int tDirection) {
         return mRayAttacks[tSquare][tDirection];
     }
-    constexpr uint64_t knightAttacks (int tSquare) const {
+    static constexpr uint64_t knightAttacks (int tSquare) {
         return mKnightAttacks[tSquare];
     }
-    constexpr uint64_t kingAttacks (int tSquare) const {
+    static constexpr uint64_t kingAttacks (int tSquare) {
         return mKingAttacks[tSquare];
     }
-    constexpr uint64_t rookAttacks (uint64_t tOccupied, int tSquare) const {
-        return mRMagicDb[tSquare][((tOccupied & mRMask[tSquare]) * mRMagic[tSquare]) >> mRShift[tSquare]];
+    // Each backend has its own compact table, each square owning exactly 2^bits entries.
+    // Only the one in use ever gets paged in
+    static inline uint64_t rookAttacks (uint64_t tOccupied, int tSquare) {
+        return mUsePext
+            ? mPextDb[mPextROffset[tSquare] + pext(tOccupied, mRMask[tSquare])]
+            : mMagicDb[mMagicROffset[tSquare] + (((tOccupied & mRMask[tSquare]) * mRMagic[tSquare]) >> mRShift[tSquare])];
     }
-    constexpr uint64_t bishopAttacks (uint64_t tOccupied, int tSquare) const {
-        return mBMagicDb[tSquare][((tOccupied & mBMask[tSquare]) * mBMagic[tSquare]) >> mBShift[tSquare]];
+    static inline uint64_t bishopAttacks (uint64_t tOccupied, int tSquare) {
+        return mUsePext
+            ? mPextDb[mPextBOffset[tSquare] + pext(tOccupied, mBMask[tSquare])]
+            : mMagicDb[mMagicBOffset[tSquare] + (((tOccupied & mBMask[tSquare]) * mBMagic[tSquare]) >> mBShift[tSquare])];
     }
-    constexpr uint64_t queenAttacks (uint64_t tOccupied, int tSquare) const {
+    static inline uint64_t queenAttacks (uint64_t tOccupied, int tSquare) {
         return rookAttacks(tOccupied, tSquare) | bishopAttacks(tOccupied, tSquare);
     }
 
-    uint64_t initMagicOcc(int *, int, uint64_t);
-    uint64_t initMagicBMoves(int, uint64_t);
-    uint64_t initMagicRMoves(int, uint64_t);
+#if defined(__BMI2__) || (defined(_MSC_VER) && defined(_M_X64))
+    static inline uint64_t pext(uint64_t tSource, uint64_t tMask) {return _pext_u64(tSource, tMask);}
+#else
+    // Built for BMI2 on its own, so it only runs when CPUID reports support
+    static uint64_t pext(uint64_t tSource, uint64_t tMask);
+#endif
+    static bool hasFastPext();
+
+    // Compile time generators
+    static constexpr int bitCount(uint64_t tBitboard) {
+        int count = 0;
+        for (; tBitboard; tBitboard &= tBitboard - 1) count ++;
+        return count;
+    }
+    static constexpr uint64_t slide(int tSquare, int tFileStep, int tRankStep, uint64_t tOccupied) {
+        uint64_t ray = 0;
+        int file = tSquare % 8 + tFileStep, rank = tSquare / 8 + tRankStep;
+        for (; file >= 0 && file < 8 && rank >= 0 && rank < 8; file += tFileStep, rank += tRankStep) {
+            const uint64_t bit = uint64_t(1) << (8 * rank + file);
+            ray |= bit;
+            if (bit & tOccupied) break;
+        }
+        return ray;
+    }
+    static constexpr uint64_t rookSlide(int tSquare, uint64_t tOccupied) {
+        return slide(tSquare, 1, 0, tOccupied) | slide(tSquare, -1, 0, tOccupied)
+             | slide(tSquare, 0, 1, tOccupied) | slide(tSquare, 0, -1, tOccupied);
+    }
+    static constexpr uint64_t bishopSlide(int tSquare, uint64_t tOccupied) {
+        return slide(tSquare, 1, 1, tOccupied) | slide(tSquare, 1, -1, tOccupied)
+             | slide(tSquare, -1, 1, tOccupied) | slide(tSquare, -1, -1, tOccupied);
+    }
+    static constexpr RayTable initRayAttacks();
+    static constexpr SquareTable initKnightAttacks();
+    static constexpr SquareTable initKingAttacks();
+    static constexpr PawnTable initPawnAttacks();
+    static constexpr PairTable initBetween();
+    static constexpr PairTable initLines();
+    static constexpr OffsetTable initOffsets(bool tRook, bool tPext);
 
 private:
-    static MagicBitboards *mInstance;
-
-    uint64_t mRayAttacks[64][8]; 
-    uint64_t mKnightAttacks[64];
-    uint64_t mKingAttacks[64];
-    uint64_t mPawnAttacks[64][2];
-
-    const unsigned int mRShift[64];
-    const uint64_t mRMask[64];
-    const uint64_t mRMagic[64];
-    const unsigned int mBShift[64];
-    const uint64_t mBMask[64];
-    const uint64_t mBMagic[64];
-
-    uint64_t mRMagicDb[64][1<<12];
-    uint64_t mBMagicDb[64][1<<9];
-};
\ No newline at end of file
+    static const MagicBitboards mInstance;
+
+    // Fixed patterns are defined in this header so that they can be folded, the bigger
+    // tables are only ever indexed at runtime and are generated in MagicBitboards.cpp
+    static const bool mUsePext;
+
+    static constexpr unsigned int mRShift[64] = {
+        52, 53, 53, 53, 53, 53, 53, 52,
+        53, 54, 54, 54, 54, 54, 54, 53,
+        53, 54, 54, 54, 54, 54, 54, 53,
+        53, 54, 54, 54, 54, 54, 54, 53,
+        53, 54, 54, 54, 54, 54, 54, 53,
+        53, 54, 54, 54, 54, 54, 54, 53,
+        53, 54, 54, 54, 54, 54, 54, 53,
+        53, 54, 54, 53, 53, 53, 53, 53
+    };
+    static constexpr uint64_t mRMask[64] = {
+        uint64_t(0x000101010101017E), uint64_t(0x000202020202027C), uint64_t(0x000404040404047A), uint64_t(0x0008080808080876),
+        uint64_t(0x001010101010106E), uint64_t(0x002020202020205E), uint64_t(0x004040404040403E), uint64_t(0x008080808080807E),
+        uint64_t(0x0001010101017E00), uint64_t(0x0002020202027C00), uint64_t(0x0004040404047A00), uint64_t(0x0008080808087600),
+        uint64_t(0x0010101010106E00), uint64_t(0x0020202020205E00), uint64_t(0x0040404040403E00), uint64_t(0x0080808080807E00),
+        uint64_t(0x00010101017E0100), uint64_t(0x00020202027C0200), uint64_t(0x00040404047A0400), uint64_t(0x0008080808760800),
+        uint64_t(0x00101010106E1000), uint64_t(0x00202020205E2000), uint64_t(0x00404040403E4000), uint64_t(0x00808080807E8000),
+        uint64_t(0x000101017E010100), uint64_t(0x000202027C020200), uint64_t(0x000404047A040400), uint64_t(0x0008080876080800),
+        uint64_t(0x001010106E101000), uint64_t(0x002020205E202000), uint64_t(0x004040403E404000), uint64_t(0x008080807E808000),
+        uint64_t(0x0001017E01010100), uint64_t(0x0002027C02020200), uint64_t(0x0004047A04040400), uint64_t(0x0008087608080800),
+        uint64_t(0x0010106E10101000), uint64_t(0x0020205E20202000), uint64_t(0x0040403E40404000), uint64_t(0x0080807E80808000),
+        uint64_t(0x00017E0101010100), uint64_t(0x00027C0202020200), uint64_t(0x00047A0404040400), uint64_t(0x0008760808080800),
+        uint64_t(0x00106E1010101000), uint64_t(0x00205E2020202000), uint64_t(0x00403E4040404000), uint64_t(0x00807E8080808000),
+        uint64_t(0x007E010101010100), uint64_t(0x007C020202020200), uint64_t(0x007A040404040400), uint64_t(0x0076080808080800),
+        uint64_t(0x006E101010101000), uint64_t(0x005E202020202000), uint64_t(0x003E404040404000), uint64_t(0x007E808080808000),
+        uint64_t(0x7E01010101010100), uint64_t(0x7C02020202020200), uint64_t(0x7A04040404040400), uint64_t(0x7608080808080800),
+        uint64_t(0x6E10101010101000), uint64_t(0x5E20202020202000), uint64_t(0x3E40404040404000), uint64_t(0x7E80808080808000)
+    };
+    static constexpr uint64_t mRMagic[64] = {
+        uint64_t(0x0080001020400080), uint64_t(0x0040001000200040), uint64_t(0x0080081000200080), uint64_t(0x0080040800100080),
+        uint64_t(0x0080020400080080), uint64_t(0x0080010200040080), uint64_t(0x0080008001000200), uint64_t(0x0080002040800100),
+        uint64_t(0x0000800020400080), uint64_t(0x0000400020005000), uint64_t(0x0000801000200080), uint64_t(0x0000800800100080),
+        uint64_t(0x0000800400080080), uint64_t(0x0000800200040080), uint64_t(0x0000800100020080), uint64_t(0x0000800040800100),
+        uint64_t(0x0000208000400080), uint64_t(0x0000404000201000), uint64_t(0x0000808010002000), uint64_t(0x0000808008001000),
+        uint64_t(0x0000808004000800), uint64_t(0x0000808002000400), uint64_t(0x0000010100020004), uint64_t(0x0000020000408104),
+        uint64_t(0x0000208080004000), uint64_t(0x0000200040005000), uint64_t(0x0000100080200080), uint64_t(0x0000080080100080),
+        uint64_t(0x0000040080080080), uint64_t(0x0000020080040080), uint64_t(0x0000010080800200), uint64_t(0x0000800080004100),
+        uint64_t(0x0000204000800080), uint64_t(0x0000200040401000), uint64_t(0x0000100080802000), uint64_t(0x0000080080801000),
+        uint64_t(0x0000040080800800), uint64_t(0x0000020080800400), uint64_t(0x0000020001010004), uint64_t(0x0000800040800100),
+        uint64_t(0x0000204000808000), uint64_t(0x0000200040008080), uint64_t(0x0000100020008080), uint64_t(0x0000080010008080),
+        uint64_t(0x0000040008008080), uint64_t(0x0000020004008080), uint64_t(0x0000010002008080), uint64_t(0x0000004081020004),
+        uint64_t(0x0000204000800080), uint64_t(0x0000200040008080), uint64_t(0x0000100020008080), uint64_t(0x0000080010008080),
+        uint64_t(0x0000040008008080), uint64_t(0x0000020004008080), uint64_t(0x0000800100020080), uint64_t(0x0000800041000080),
+        uint64_t(0x00FFFCDDFCED714A), uint64_t(0x007FFCDDFCED714A), uint64_t(0x003FFFCDFFD88096), uint64_t(0x0000040810002101),
+        uint64_t(0x0001000204080011), uint64_t(0x0001000204000801), uint64_t(0x0001000082000401), uint64_t(0x0001FFFAABFAD1A2)
+    };
+    static constexpr unsigned int mBShift[64] = {
+        58, 59, 59, 59, 59, 59, 59, 58,
+        59, 59, 59, 59, 59, 59, 59, 59,
+        59, 59, 57, 57, 57, 57, 59, 59,
+        59, 59, 57, 55, 55, 57, 59, 59,
+        59, 59, 57, 55, 55, 57, 59, 59,
+        59, 59, 57, 57, 57, 57, 59, 59,
+        59, 59, 59, 59, 59, 59, 59, 59,
+        58, 59, 59, 59, 59, 59, 59, 58
+    };
+    static constexpr uint64_t mBMask[64] = {
+        uint64_t(0x0040201008040200), uint64_t(0x0000402010080400), uint64_t(0x0000004020100A00), uint64_t(0x0000000040221400),
+        uint64_t(0x0000000002442800), uint64_t(0x0000000204085000), uint64_t(0x0000020408102000), uint64_t(0x0002040810204000),
+        uint64_t(0x0020100804020000), uint64_t(0x0040201008040000), uint64_t(0x00004020100A0000), uint64_t(0x0000004022140000),
+        uint64_t(0x0000000244280000), uint64_t(0x0000020408500000), uint64_t(0x0002040810200000), uint64_t(0x0004081020400000),
+        uint64_t(0x0010080402000200), uint64_t(0x0020100804000400), uint64_t(0x004020100A000A00), uint64_t(0x0000402214001400),
+        uint64_t(0x0000024428002800), uint64_t(0x0002040850005000), uint64_t(0x0004081020002000), uint64_t(0x0008102040004000),
+        uint64_t(0x0008040200020400), uint64_t(0x0010080400040800), uint64_t(0x0020100A000A1000), uint64_t(0x0040221400142200),
+        uint64_t(0x0002442800284400), uint64_t(0x0004085000500800), uint64_t(0x0008102000201000), uint64_t(0x0010204000402000),
+        uint64_t(0x0004020002040800), uint64_t(0x0008040004081000), uint64_t(0x00100A000A102000), uint64_t(0x0022140014224000),
+        uint64_t(0x0044280028440200), uint64_t(0x0008500050080400), uint64_t(0x0010200020100800), uint64_t(0x0020400040201000),
+        uint64_t(0x0002000204081000), uint64_t(0x0004000408102000), uint64_t(0x000A000A10204000), uint64_t(0x0014001422400000),
+        uint64_t(0x0028002844020000), uint64_t(0x0050005008040200), uint64_t(0x0020002010080400), uint64_t(0x0040004020100800),
+        uint64_t(0x0000020408102000), uint64_t(0x0000040810204000), uint64_t(0x00000A1020400000), uint64_t(0x0000142240000000),
+        uint64_t(0x0000284402000000), uint64_t(0x0000500804020000), uint64_t(0x0000201008040200), uint64_t(0x0000402010080400),
+        uint64_t(0x0002040810204000), uint64_t(0x0004081020400000), uint64_t(0x000A102040000000), uint64_t(0x0014224000000000),
+        uint64_t(0x0028440200000000), uint64_t(0x0050080402000000), uint64_t(0x0020100804020000), uint64_t(0x0040201008040200)
+    };
+    static constexpr uint64_t mBMagic[64] = {
+        uint64_t(0x0002020202020200), uint64_t(0x0002020202020000), uint64_t(0x0004010202000000), uint64_t(0x0004040080000000),
+        uint64_t(0x0001104000000000), uint64_t(0x0000821040000000), uint64_t(0x0000410410400000), uint64_t(0x0000104104104000),
+        uint64_t(0x0000040404040400), uint64_t(0x0000020202020200), uint64_t(0x0000040102020000), uint64_t(0x0000040400800000),
+        uint64_t(0x0000011040000000), uint64_t(0x0000008210400000), uint64_t(0x0000004104104000), uint64_t(0x0000002082082000),
+        uint64_t(0x0004000808080800), uint64_t(0x0002000404040400), uint64_t(0x0001000202020200), uint64_t(0x0000800802004000),
+        uint64_t(0x0000800400A00000), uint64_t(0x0000200100884000), uint64_t(0x0000400082082000), uint64_t(0x0000200041041000),
+        uint64_t(0x0002080010101000), uint64_t(0x0001040008080800), uint64_t(0x0000208004010400), uint64_t(0x0000404004010200),
+        uint64_t(0x0000840000802000), uint64_t(0x0000404002011000), uint64_t(0x0000808001041000), uint64_t(0x0000404000820800),
+        uint64_t(0x0001041000202000), uint64_t(0x0000820800101000), uint64_t(0x0000104400080800), uint64_t(0x0000020080080080),
+        uint64_t(0x0000404040040100), uint64_t(0x0000808100020100), uint64_t(0x0001010100020800), uint64_t(0x0000808080010400),
+        uint64_t(0x0000820820004000), uint64_t(0x0000410410002000), uint64_t(0x0000082088001000), uint64_t(0x0000002011000800),
+        uint64_t(0x0000080100400400), uint64_t(0x0001010101000200), uint64_t(0x0002020202000400), uint64_t(0x0001010101000200),
+        uint64_t(0x0000410410400000), uint64_t(0x0000208208200000), uint64_t(0x0000002084100000), uint64_t(0x0000000020880000),
+        uint64_t(0x0000001002020000), uint64_t(0x0000040408020000), uint64_t(0x0004040404040000), uint64_t(0x0002020202020000),
+        uint64_t(0x0000104104104000), uint64_t(0x0000002082082000), uint64_t(0x0000000020841000), uint64_t(0x0000000000208800),
+        uint64_t(0x0000000010020200), uint64_t(0x0000000404080200), uint64_t(0x0000040404040400), uint64_t(0x0002020202020200)
+    };
+    static constexpr unsigned int rookBits(int tSquare, bool tPext) {return tPext ? bitCount(mRMask[tSquare]) : 64 - mRShift[tSquare];}
+    static constexpr unsigned int bishopBits(int tSquare, bool tPext) {return tPext ? bitCount(mBMask[tSquare]) : 64 - mBShift[tSquare];}
+    static constexpr unsigned int tableSize(bool tPext);
+    static constexpr unsigned int PEXT_ENTRIES = 107648;    // 102400 rook + 5248 bishop
+    static constexpr unsigned int MAGIC_ENTRIES = 101504;
+
+    static const RayTable mRayAttacks;
+    static const SquareTable mKnightAttacks;
+    static const SquareTable mKingAttacks;
+    static const PawnTable mPawnAttacks;
+    static const PairTable mBetween;
+    static const PairTable mLine;
+
+    static const OffsetTable mPextROffset, mPextBOffset;
+    static const OffsetTable mMagicROffset, mMagicBOffset;
+    static const std::array<uint64_t, PEXT_ENTRIES> mPextDb;
+    static const std::array<uint64_t, MAGIC_ENTRIES> mMagicDb;
+
+    static constexpr std::array<uint64_t, PEXT_ENTRIES> initPextDb();
+    static constexpr std::array<uint64_t, MAGIC_ENTRIES> initMagicDb();
+};
+
+constexpr unsigned int MagicBitboards::tableSize(bool tPext)
+{
+    unsigned int size = 0;
+    for (int square = 0; square < 64; square ++) size += (1U << rookBits(square, tPext)) + (1U << bishopBits(square, tPext));
+    return size;
+}
+
+constexpr MagicBitboards::OffsetTable MagicBitboards::initOffsets(bool tRook, bool tPext)
+{
+    static_assert(tableSize(true) == PEXT_ENTRIES, "PEXT table size mismatch");
+    static_assert(tableSize(false) == MAGIC_ENTRIES, "Magic table size mismatch");
+
+    // Squares are packed one after the other, rooks first then bishops
+    OffsetTable table {};
+    unsigned int offset = 0;
+    for (int square = 0; square < 64; square ++){
+        if (tRook) table[square] = offset;
+        offset += 1U << rookBits(square, tPext);
+    }
+    for (int square = 0; square < 64; square ++){
+        if (!tRook) table[square] = offset;
+        offset += 1U << bishopBits(square, tPext);
+    }
+    return table;
+}
+
+constexpr MagicBitboards::SquareTable MagicBitboards::initKnightAttacks()
+{
+    SquareTable table {};
+    for (int square = 0; square < 64; square ++){
+        const uint64_t knightPos = uint64_t(1) << square;
+        const uint64_t eastDir = cpyWrapEast(knightPos);
+        const uint64_t eaEaDir = cpyWrapEast(eastDir);
+        const uint64_t westDir = cpyWrapWest(knightPos);
+        const uint64_t weWeDir = cpyWrapWest(westDir);
+        table[square] = eastDir << 16 | eaEaDir << 8 | eastDir >> 16 | eaEaDir >> 8
+                      | westDir << 16 | weWeDir << 8 | westDir >> 16 | weWeDir >> 8;
+    }
+    return table;
+}
+
+constexpr MagicBitboards::SquareTable MagicBitboards::initKingAttacks()
+{
+    SquareTable table {};
+    for (int square = 0; square < 64; square ++){
+        const uint64_t kingPosition = uint64_t(1) << square;
+        const uint64_t eastDir = cpyWrapEast(kingPosition);
+        const uint64_t westDir = cpyWrapWest(kingPosition);
+        table[square] = kingPosition << 8 | kingPosition >> 8
+                      | eastDir | eastDir << 8 | eastDir >> 8
+                      | westDir | westDir << 8 | westDir >> 8;
+    }
+    return table;
+}
+
+constexpr MagicBitboards::PawnTable MagicBitboards::initPawnAttacks()
+{
+    PawnTable table {};
+    for (int square = 0; square < 64; square ++){
+        const uint64_t nortDir = uint64_t(1) << square << 8;
+        const uint64_t soutDir = uint64_t(1) << square >> 8;
+        table[square][white] = cpyWrapEast(nortDir) | cpyWrapWest(nortDir);
+        table[square][black] = cpyWrapEast(soutDir) | cpyWrapWest(soutDir);
+    }
+    return table;
+}
+
+inline constexpr MagicBitboards MagicBitboards::mInstance {};
+
+inline constexpr MagicBitboards::SquareTable MagicBitboards::mKnightAttacks = initKnightAttacks();
+inline constexpr MagicBitboards::SquareTable MagicBitboards::mKingAttacks = initKingAttacks();
+inline constexpr MagicBitboards::PawnTable MagicBitboards::mPawnAttacks = initPawnAttacks();
+
+inline constexpr MagicBitboards::OffsetTable MagicBitboards::mPextROffset  = initOffsets(true, true);
+inline constexpr MagicBitboards::OffsetTable MagicBitboards::mPextBOffset  = initOffsets(false, true);
+inline constexpr MagicBitboards::OffsetTable MagicBitboards::mMagicROffset = initOffsets(true, false);
+inline constexpr MagicBitboards::OffsetTable MagicBitboards::mMagicBOffset = initOffsets(false, false);
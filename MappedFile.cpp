@@ -0,0 +1,67 @@
+#include "MappedFile.hpp"
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+bool MappedFile::open(const std::string &tPath, bool tRandomAccess)
+{
+    close();
+#if defined(_WIN32)
+    HANDLE handle = CreateFileA(tPath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                tRandomAccess ? FILE_FLAG_RANDOM_ACCESS : FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (handle == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(handle, &size) || !size.QuadPart) {
+        CloseHandle(handle);
+        return false;
+    }
+    HANDLE mapping = CreateFileMapping(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(handle);
+    if (!mapping) return false;
+    void *base = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!base) {
+        CloseHandle(mapping);
+        return false;
+    }
+    mMapping = mapping;
+    mSize = size_t(size.QuadPart);
+#else
+    const int fd = ::open(tPath.c_str(), O_RDONLY);
+    if (fd == -1) return false;
+    struct stat statbuf;
+    if (fstat(fd, &statbuf) || !statbuf.st_size) {
+        ::close(fd);
+        return false;
+    }
+    void *base = mmap(nullptr, statbuf.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED) return false;
+    if (tRandomAccess) madvise(base, statbuf.st_size, MADV_RANDOM);
+    mSize = size_t(statbuf.st_size);
+#endif
+    mData = static_cast<const uint8_t*>(base);
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (!mData) return;
+#if defined(_WIN32)
+    UnmapViewOfFile(mData);
+    CloseHandle(mMapping);
+    mMapping = nullptr;
+#else
+    munmap(const_cast<uint8_t*>(mData), mSize);
+#endif
+    mData = nullptr;
+    mSize = 0;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Read-only memory mapping of a whole file. Pages are only read from disk when touched,
+// so large files can be opened without loading them
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    ~MappedFile() {close();}
+
+    MappedFile(const MappedFile&)             =delete;
+    MappedFile& operator=(const MappedFile&)  =delete;
+
+    /**
+     * @brief Maps the given file, dropping the previous mapping if any
+     *
+     * @param tPath Location of the file
+     * @param tRandomAccess Hints the kernel not to read ahead, for files probed at scattered offsets
+     * @return true if the file exists, is not empty and could be mapped
+     */
+    bool open(const std::string &tPath, bool tRandomAccess);
+    void close();
+
+    inline bool isOpen() const {return mData;}
+    inline const uint8_t* data() const {return mData;}
+    inline size_t size() const {return mSize;}
+
+private:
+    const uint8_t *mData = nullptr;
+    size_t mSize = 0;
+#if defined(_WIN32)
+    void *mMapping = nullptr;
+#endif
+};
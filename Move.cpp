@@ -1,21 +1,11 @@
 #include "Move.hpp"
 #include <array>
 
-Move::Move(const Move &tOther)
-{
-    mMove = tOther.mMove;
-}
-
 Move::Move(int tFrom, int tTo, int tFlag)
 {
     mMove = (tFlag & 0x0f) << 12 | (tFrom & 0x3f) << 6 | (tTo & 0x3f);
 }
 
-void Move::operator=(Move tOther)
-{
-    mMove = tOther.mMove;
-}
-
 std::string Move::asString() const
 {
     std::string output;
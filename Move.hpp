@@ -8,10 +8,10 @@
 class Move{
 public:
     Move(): mMove{0U}{}
-    Move(const Move &);
+    Move(const Move &) = default;
     Move(int tFrom, int tTo, int tFlag);
 
-    void operator= (Move otherObj);
+    Move& operator= (const Move &) = default;
     friend bool operator== (const Move& thisObj, const Move& otherObj);
     friend bool operator!= (const Move& thisObj, const Move& otherObj);
     friend std::ostream& operator<< (std::ostream& os, const Move& cm);
@@ -5,245 +5,373 @@
 #include "utils.hpp"
 #include <array>
 #include <cstdint>
-#include <vector>
 
-void MoveGenerator::generate(uint64_t tTarget, const Board& tBoard, std::vector<Move>& tList) const{
-    for (int piece = knight; piece <= king; piece ++) pieceMoves(tTarget, piece, tList, tBoard);
-    pawnMoves(tTarget, tList, tBoard);
-    
-    if(tBoard.getEpState() == true) enPassants(tTarget, tList, tBoard);
+// Pawn moves seen from the side to move, everything resolves at compile time
+template <int tSide>
+static constexpr uint64_t pawnPush(uint64_t tSet) {return tSide == white ? tSet << 8 : tSet >> 8;}
+
+template <int tSide>
+static constexpr uint64_t relativeRank(int tRank) {return uint64_t(0xff) << 8 * (tSide == white ? tRank : 7 - tRank);}
 
-    castles(tList, tBoard);
+template <int tStage>
+void MoveGenerator::generate(const Board& tBoard, MoveList &tList) const{
+    if (tBoard.getSideToMove() == white) generate<white, tStage>(tBoard, tList);
+    else generate<black, tStage>(tBoard, tList);
 }
 
-void MoveGenerator::pieceMoves(uint64_t tTarget, int tPiece, std::vector<Move> &tList, const Board &tBoard) const
+template <int tStage>
+void MoveGenerator::generateLegal(const Board& tBoard, MoveList &tList) const{
+    if (tBoard.getSideToMove() == white) generateLegal<white, tStage>(tBoard, tList);
+    else generateLegal<black, tStage>(tBoard, tList);
+}
+
+template <int tSide, int tStage>
+uint64_t MoveGenerator::stageTarget(const Board& tBoard) const{
+    const uint64_t occupied = tBoard.getBitboard(white) | tBoard.getBitboard(black);
+    if constexpr (tStage == captureGen) return tBoard.getBitboard(1 - tSide);
+    else if constexpr (tStage == quietGen) return ~occupied;
+    else if constexpr (tStage == evasionGen) {
+        const int kingSquare = tBoard.getKingSquare(tSide);
+        return MagicBitboards::attacks<queen>(kingSquare, occupied) | MagicBitboards::attacks<knight>(kingSquare, occupied);
+    }
+    else return UINT64_MAX;
+}
+
+template <int tSide, int tStage>
+void MoveGenerator::generate(const Board& tBoard, MoveList &tList) const{
+    const uint64_t target = stageTarget<tSide, tStage>(tBoard);
+    const uint64_t ownSet = tBoard.getBitboard(tSide);
+    pieceMoves<knight, tStage>(target, tBoard.getBitboard(knight) & ownSet, tList, tBoard);
+    pieceMoves<bishop, tStage>(target, tBoard.getBitboard(bishop) & ownSet, tList, tBoard);
+    pieceMoves<rook, tStage>(target, tBoard.getBitboard(rook)   & ownSet, tList, tBoard);
+    pieceMoves<queen, tStage>(target, tBoard.getBitboard(queen)  & ownSet, tList, tBoard);
+    pieceMoves<king, tStage>(target, tBoard.getBitboard(king)   & ownSet, tList, tBoard);
+    pawnMoves<tSide, tStage>(target, tBoard.getBitboard(pawn) & ownSet, tList, tBoard);
+
+    // En-passant lands on an empty square, castles never capture
+    if constexpr (tStage != captureGen) {
+        if(tBoard.getEpState() == true) enPassants<tSide>(target, tList, tBoard);
+        if constexpr (tStage != evasionGen) castles<tSide>(tList, tBoard);
+    }
+}
+
+template <int tSide, int tStage>
+void MoveGenerator::generateLegal(const Board& tBoard, MoveList &tList) const{
+    const uint64_t tTarget = stageTarget<tSide, tStage>(tBoard);
+    const int kingSquare = tBoard.getKingSquare(tSide);
+    const uint64_t ownSet = tBoard.getBitboard(tSide);
+    const uint64_t kingSet = uint64_t(1) << kingSquare;
+    const uint64_t occupied = tBoard.getBitboard(white) | tBoard.getBitboard(black);
+    const uint64_t checkers = attackersTo(tBoard, kingSquare, occupied) & tBoard.getBitboard(1 - tSide);
+
+    // The king can't step on attacked squares, nor keep standing on a slider's line
+    uint64_t kingTargets = MagicBitboards::attacks<king>(kingSquare, occupied) & tTarget & ~ownSet, safeSet = 0;
+    if (kingTargets) do {
+        const int square = bitScanForward(kingTargets);
+        if (!isAttacked(tBoard, square, 1 - tSide, occupied ^ kingSet)) safeSet |= uint64_t(1) << square;
+    } while (kingTargets &= (kingTargets - 1));
+    pieceMoves<king, tStage>(safeSet, kingSet, tList, tBoard);
+
+    // Only the king can escape a double check
+    if (checkers & (checkers - 1)) return;
+
+    // Every other move has to capture the checker or block its line
+    const uint64_t checkMask = checkers ? checkers | mLookup.betweenSquares(kingSquare, bitScanForward(checkers)) : UINT64_MAX;
+    const uint64_t target = tTarget & checkMask;
+    const uint64_t pinned = pinnedPieces(tBoard, tSide, kingSquare);
+    const uint64_t freeSet = ownSet & ~pinned;
+
+    // Pinned knights never move, other pinned pieces stay on the line through their king
+    pieceMoves<knight, tStage>(target, tBoard.getBitboard(knight) & freeSet, tList, tBoard);
+    pieceMoves<bishop, tStage>(target, tBoard.getBitboard(bishop) & freeSet, tList, tBoard);
+    pieceMoves<rook, tStage>(target, tBoard.getBitboard(rook)   & freeSet, tList, tBoard);
+    pieceMoves<queen, tStage>(target, tBoard.getBitboard(queen)  & freeSet, tList, tBoard);
+    pawnMoves<tSide, tStage>(target, tBoard.getBitboard(pawn) & freeSet, tList, tBoard);
+
+    uint64_t pinnedSet = pinned & ~tBoard.getBitboard(knight);
+    if (pinnedSet) do {
+        const int square = bitScanForward(pinnedSet);
+        const uint64_t pinLine = target & mLookup.lineThrough(kingSquare, square);
+        const uint64_t pieceSet = uint64_t(1) << square;
+        switch (tBoard.searchPiece(square)) {
+            case pawn:   pawnMoves<tSide, tStage>(pinLine, pieceSet, tList, tBoard); break;
+            case bishop: pieceMoves<bishop, tStage>(pinLine, pieceSet, tList, tBoard); break;
+            case rook:   pieceMoves<rook, tStage>(pinLine, pieceSet, tList, tBoard); break;
+            default:     pieceMoves<queen, tStage>(pinLine, pieceSet, tList, tBoard); break;
+        }
+    } while (pinnedSet &= (pinnedSet - 1));
+
+    if constexpr (tStage != captureGen) {
+        // En-passant removes two pieces from the same rank, so it gets the exact test
+        if (tBoard.getEpState() == true) {
+            const size_t first = tList.size();
+            enPassants<tSide>(tTarget, tList, tBoard);
+            for (size_t i = first; i < tList.size();)
+                if (isLegalEnPassant(tBoard, tList[i], checkers)) i ++;
+                else {
+                    tList[i] = tList.back();
+                    tList.pop();
+                }
+        }
+
+        if (!checkers) castles<tSide>(tList, tBoard);
+    }
+}
+
+// Not split per colour, only the enemy set depends on it and the extra copies cost more than they save
+template <int tPiece, int tStage>
+void MoveGenerator::pieceMoves(uint64_t tTarget, uint64_t tPieceSet, MoveList &tList, const Board &tBoard) const
 {
-    uint64_t pieceSet = tBoard.getBitboard(tPiece) & tBoard.getBitboard(tBoard.getSideToMove());
+    uint64_t pieceSet = tPieceSet;
     uint64_t occupied = tBoard.getBitboard(white) | tBoard.getBitboard(black);
     uint64_t enemySet = tBoard.getBitboard(1 - tBoard.getSideToMove());
 
     if (pieceSet) do {
         int startingSquare = bitScanForward(pieceSet);
-        uint64_t attackSet = mLookup.getAttacks(tPiece, startingSquare, occupied);
-
-        uint64_t quietMoves = attackSet & tTarget & ~occupied;
-        if (quietMoves) do {
-            int endSquare = bitScanForward(quietMoves);
-            tList.emplace_back(Move(startingSquare, endSquare, quiet));
-        } while (quietMoves &= (quietMoves - 1));
-
-        uint64_t captures = attackSet & tTarget & enemySet;
-        if (captures) do {
-            int endSquare = bitScanForward(captures);
-            tList.emplace_back(Move(startingSquare, endSquare, capture));
-        } while (captures &= (captures - 1));
+        uint64_t attackSet = MagicBitboards::attacks<tPiece>(startingSquare, occupied);
+
+        if constexpr (tStage != captureGen) {
+            uint64_t quietMoves = attackSet & tTarget & ~occupied;
+            if (quietMoves) do {
+                int endSquare = bitScanForward(quietMoves);
+                tList.push(Move(startingSquare, endSquare, quiet));
+            } while (quietMoves &= (quietMoves - 1));
+        }
+
+        if constexpr (tStage != quietGen) {
+            uint64_t captures = attackSet & tTarget & enemySet;
+            if (captures) do {
+                int endSquare = bitScanForward(captures);
+                tList.push(Move(startingSquare, endSquare, capture));
+            } while (captures &= (captures - 1));
+        }
     } while (pieceSet &= (pieceSet - 1));
 }
 
-
-
-void MoveGenerator::pawnMoves(uint64_t tTarget, std::vector<Move> &tList, const Board &tBoard) const
+template <int tSide, int tStage>
+void MoveGenerator::pawnMoves(uint64_t tTarget, uint64_t tPawnSet, MoveList &tList, const Board &tBoard) const
 {
-    uint64_t doublePushSet, pushSet, promoSet, eastCaptures, westCaptures, eastPromoCaptures, westPromoCaptures;
-    int pushOffset, eastOffset, westOffset;
-
-
-    if(tBoard.getSideToMove() == white) {
-        static constexpr uint64_t rank4 = uint64_t(0x00000000ff000000);
-        static constexpr uint64_t rank8 = uint64_t(0xff00000000000000);
-
-        const uint64_t emptySet = ~(tBoard.getBitboard(white) | tBoard.getBitboard(black));
-        const uint64_t enemySet = tBoard.getBitboard(black);
-        const uint64_t pawnSet = tBoard.getBitboard(pawn) & tBoard.getBitboard(white);
-
-        doublePushSet = (pawnSet << 8) & emptySet;
-        doublePushSet = (doublePushSet << 8) & emptySet & rank4 & tTarget;
-        pushSet  = pawnSet << 8 & ~rank8 & emptySet & tTarget;
-        promoSet = pawnSet << 8 &  rank8 & emptySet & tTarget;
-        eastCaptures      = cpyWrapEast(pawnSet) << 8 & ~rank8 & enemySet & tTarget;
-        eastPromoCaptures = cpyWrapEast(pawnSet) << 8 &  rank8 & enemySet & tTarget;
-        westCaptures      = cpyWrapWest(pawnSet) << 8 & ~rank8 & enemySet & tTarget;
-        westPromoCaptures = cpyWrapWest(pawnSet) << 8 &  rank8 & enemySet & tTarget;
-
-        eastOffset = -9;
-        westOffset = -7;
-        pushOffset = -8;
+    // Offsets take the destination square back to the starting one
+    static constexpr int pushOffset = tSide == white ? -8 : 8;
+    static constexpr int eastOffset = tSide == white ? -9 : 7;
+    static constexpr int westOffset = tSide == white ? -7 : 9;
+    static constexpr uint64_t doublePushRank = relativeRank<tSide>(3);
+    static constexpr uint64_t promoRank = relativeRank<tSide>(7);
+
+    const uint64_t emptySet = ~(tBoard.getBitboard(white) | tBoard.getBitboard(black));
+    const uint64_t enemySet = tBoard.getBitboard(1 - tSide);
+    const uint64_t pawnSet = tPawnSet;
+
+    if constexpr (tStage != captureGen) {
+        const uint64_t singlePushSet = pawnPush<tSide>(pawnSet) & emptySet;
+        uint64_t doublePushSet = pawnPush<tSide>(singlePushSet) & emptySet & doublePushRank & tTarget;
+        uint64_t pushSet  = singlePushSet & ~promoRank & tTarget;
+        uint64_t promoSet = singlePushSet &  promoRank & tTarget;
+
+        if (doublePushSet) do {
+            int endSq = bitScanForward(doublePushSet);
+            int startSq = endSq + (2 * pushOffset);
+            tList.push(Move(startSq, endSq, doublePush));
+        } while (doublePushSet  &= (doublePushSet - 1));
+
+        if (pushSet) do {
+            int endSq = bitScanForward(pushSet);
+            int startSq = endSq + pushOffset;
+            tList.push(Move(startSq, endSq, quiet));
+        } while (pushSet &= (pushSet - 1));
+
+        if (promoSet) do {
+            int endSq = bitScanForward(promoSet);
+            int startSq = endSq + pushOffset;
+            tList.push(Move(startSq, endSq, knightPromo));
+            tList.push(Move(startSq, endSq, bishopPromo));
+            tList.push(Move(startSq, endSq, rookPromo));
+            tList.push(Move(startSq, endSq, queenPromo));
+        } while (promoSet &= (promoSet - 1));
     }
-    else {
-        static constexpr uint64_t rank5 = uint64_t(0x000000ff00000000);
-        static constexpr uint64_t rank1 = uint64_t(0x00000000000000ff);
-
-        const uint64_t emptySet = ~(tBoard.getBitboard(white) | tBoard.getBitboard(black));
-        const uint64_t enemySet = tBoard.getBitboard(white);
-        const uint64_t pawnSet = tBoard.getBitboard(pawn) & tBoard.getBitboard(black);
-
-        doublePushSet = ((pawnSet >> 8) & emptySet) >> 8 & emptySet & rank5 & tTarget;
-        pushSet  = pawnSet >> 8 & ~rank1 & emptySet & tTarget;
-        promoSet = pawnSet >> 8 &  rank1 & emptySet & tTarget;
-        eastCaptures      = cpyWrapEast(pawnSet) >> 8 & ~rank1 & enemySet & tTarget;
-        eastPromoCaptures = cpyWrapEast(pawnSet) >> 8 &  rank1 & enemySet & tTarget;
-        westCaptures      = cpyWrapWest(pawnSet) >> 8 & ~rank1 & enemySet & tTarget;
-        westPromoCaptures = cpyWrapWest(pawnSet) >> 8 &  rank1 & enemySet & tTarget;
-
-        eastOffset = 7;
-        westOffset = 9;
-        pushOffset = 8;
+
+    if constexpr (tStage != quietGen) {
+        const uint64_t eastSet = pawnPush<tSide>(cpyWrapEast(pawnSet)) & enemySet & tTarget;
+        const uint64_t westSet = pawnPush<tSide>(cpyWrapWest(pawnSet)) & enemySet & tTarget;
+        uint64_t eastCaptures      = eastSet & ~promoRank;
+        uint64_t eastPromoCaptures = eastSet &  promoRank;
+        uint64_t westCaptures      = westSet & ~promoRank;
+        uint64_t westPromoCaptures = westSet &  promoRank;
+
+        if (westCaptures) do {
+            int endSq = bitScanForward(westCaptures);
+            int startSq = endSq + westOffset;
+            tList.push(Move(startSq, endSq, capture));
+        } while (westCaptures &= (westCaptures - 1));
+
+        if (eastCaptures) do {
+            int endSq = bitScanForward(eastCaptures);
+            int startSq = endSq + eastOffset;
+            tList.push(Move(startSq, endSq, capture));
+        } while (eastCaptures &= (eastCaptures - 1));
+
+        if (eastPromoCaptures) do {
+            int endSq = bitScanForward(eastPromoCaptures);
+            int startSq = endSq + eastOffset;
+            tList.push(Move(startSq, endSq, knightPromoCapture));
+            tList.push(Move(startSq, endSq, bishopPromoCapture));
+            tList.push(Move(startSq, endSq, rookPromoCapture));
+            tList.push(Move(startSq, endSq, queenPromoCapture));
+        } while (eastPromoCaptures &= (eastPromoCaptures - 1));
+
+        if (westPromoCaptures) do {
+            int endSq = bitScanForward(westPromoCaptures);
+            int startSq = endSq + westOffset;
+            tList.push(Move(startSq, endSq, knightPromoCapture));
+            tList.push(Move(startSq, endSq, bishopPromoCapture));
+            tList.push(Move(startSq, endSq, rookPromoCapture));
+            tList.push(Move(startSq, endSq, queenPromoCapture));
+        } while (westPromoCaptures &= (westPromoCaptures - 1));
     }
+}
 
-    if (doublePushSet) do {
-        int endSq = bitScanForward(doublePushSet);
-        int startSq = endSq + (2 * pushOffset);
-        tList.emplace_back(Move(startSq, endSq, doublePush));
-    } while (doublePushSet  &= (doublePushSet - 1));
-
-    if (pushSet) do {
-        int endSq = bitScanForward(pushSet);
-        int startSq = endSq + pushOffset;
-        tList.emplace_back(Move(startSq, endSq, quiet));
-    } while (pushSet &= (pushSet - 1));
-
-    if (promoSet) do {
-        int endSq = bitScanForward(promoSet);
-        int startSq = endSq + pushOffset;
-        tList.emplace_back(Move(startSq, endSq, knightPromo));
-        tList.emplace_back(Move(startSq, endSq, bishopPromo));
-        tList.emplace_back(Move(startSq, endSq, rookPromo));
-        tList.emplace_back(Move(startSq, endSq, queenPromo));
-    } while (promoSet &= (promoSet - 1));
-
-
-    if (westCaptures) do {
-        int endSq = bitScanForward(westCaptures);
-        int startSq = endSq + westOffset;
-        tList.emplace_back(Move(startSq, endSq, capture));
-    } while (westCaptures &= (westCaptures - 1));
-
-
-    if (eastCaptures) do {
-        int endSq = bitScanForward(eastCaptures);
-        int startSq = endSq + eastOffset;
-        tList.emplace_back(Move(startSq, endSq, capture));
-    } while (eastCaptures &= (eastCaptures - 1));
-
-    if (eastPromoCaptures) do {
-        int endSq = bitScanForward(eastPromoCaptures);
-        int startSq = endSq + eastOffset;
-        tList.emplace_back(Move(startSq, endSq, knightPromoCapture));
-        tList.emplace_back(Move(startSq, endSq, bishopPromoCapture));
-        tList.emplace_back(Move(startSq, endSq, rookPromoCapture));
-        tList.emplace_back(Move(startSq, endSq, queenPromoCapture));
-    } while (eastPromoCaptures &= (eastPromoCaptures - 1));
-
-    if (westPromoCaptures) do {
-        int endSq = bitScanForward(westPromoCaptures);
-        int startSq = endSq + westOffset;
-        tList.emplace_back(Move(startSq, endSq, knightPromoCapture));
-        tList.emplace_back(Move(startSq, endSq, bishopPromoCapture));
-        tList.emplace_back(Move(startSq, endSq, rookPromoCapture));
-        tList.emplace_back(Move(startSq, endSq, queenPromoCapture));
-    } while (westPromoCaptures &= (westPromoCaptures - 1));
+template <int tSide>
+void MoveGenerator::castles(MoveList &tList, const Board &tBoard) const
+{
+    // Castling squares are the white ones moved to the back rank of the side to move
+    static constexpr int shift = tSide == white ? 0 : 56;
+    static constexpr uint64_t longCastleSquares = uint64_t(0x000000000000000e) << shift;
+    static constexpr uint64_t shortCastleSquares = uint64_t(0x0000000000000060) << shift;
+    const uint64_t emptySet = ~(tBoard.getBitboard(black) | tBoard.getBitboard(white));
+
+    if(
+        tBoard.getLongCastle(tSide) &&
+        (longCastleSquares & emptySet) == longCastleSquares &&
+        ! isAttacked(tBoard, c1 + shift, 1 - tSide) &&
+        ! isAttacked(tBoard, d1 + shift, 1 - tSide) &&
+        ! isAttacked(tBoard, e1 + shift, 1 - tSide)
+    ) tList.push(Move(e1 + shift, c1 + shift, queenCastle));
+
+    if(
+        tBoard.getShortCastle(tSide) &&
+        (shortCastleSquares & emptySet) == shortCastleSquares &&
+        ! isAttacked(tBoard, e1 + shift, 1 - tSide) &&
+        ! isAttacked(tBoard, f1 + shift, 1 - tSide) &&
+        ! isAttacked(tBoard, g1 + shift, 1 - tSide)
+    ) tList.push(Move(e1 + shift, g1 + shift, kingCastle));
 }
 
-void MoveGenerator::castles(std::vector<Move> &tList, const Board &tBoard) const
+template <int tSide>
+void MoveGenerator::enPassants(uint64_t tTarget, MoveList &tList, const Board &tBoard) const
 {
-    uint64_t emptySet = ~(tBoard.getBitboard(black) | tBoard.getBitboard(white));
-
-    if (tBoard.getSideToMove() == white){
-        static constexpr uint64_t longCastleSquares = uint64_t(0x000000000000000e);
-        static constexpr uint64_t shortCastleSquares = uint64_t(0x0000000000000060);
-        uint64_t intersection = longCastleSquares & emptySet;
-        if(
-            tBoard.getLongCastle(white) &&
-            (intersection == longCastleSquares) &&
-            ! isAttacked(tBoard, c1, black) &&
-            ! isAttacked(tBoard, d1, black) &&
-            ! isAttacked(tBoard, e1, black)
-        ) tList.emplace_back(Move(e1, c1, queenCastle));
-        
-        intersection = shortCastleSquares & emptySet; 
-        if(
-            tBoard.getShortCastle(white) &&
-            (intersection == shortCastleSquares) &&
-            ! isAttacked(tBoard, e1, black) &&
-            ! isAttacked(tBoard, f1, black) &&
-            ! isAttacked(tBoard, g1, black)
-        ) tList.emplace_back(Move(e1, g1, kingCastle));
-    }
-    else{
-        static constexpr uint64_t longCastleSquares = uint64_t(0x0e00000000000000);
-        static constexpr uint64_t shortCastleSquares = uint64_t(0x6000000000000000);
-        uint64_t intersection = longCastleSquares & emptySet; 
-        if(
-            tBoard.getLongCastle(black) &&
-            (intersection == longCastleSquares) &&
-            ! isAttacked(tBoard, c8, white) &&
-            ! isAttacked(tBoard, d8, white) &&
-            ! isAttacked(tBoard, e8, white)
-        ) tList.emplace_back(Move(e8, c8, queenCastle));
-
-        intersection = shortCastleSquares & emptySet;
-        if(
-            tBoard.getShortCastle(black) &&
-            (intersection == shortCastleSquares) &&
-            ! isAttacked(tBoard, e8, white) &&
-            ! isAttacked(tBoard, f8, white) &&
-            ! isAttacked(tBoard, g8, white)
-        ) tList.emplace_back(Move(e8, g8, kingCastle));
+    static constexpr int pushOffset = tSide == white ? 8 : -8;
+    const uint64_t pawnSet = tBoard.getBitboard(pawn) & tBoard.getBitboard(tSide);
+    const int epSquare = tBoard.getEpSquare();
+    const uint64_t epMask = uint64_t(1) << epSquare;
+
+    if (tTarget & pawnPush<tSide>(epMask)){
+        if (cpyWrapEast(epMask) & pawnSet) 
+            tList.push(Move(epSquare + 1, epSquare + pushOffset, enPassant));
+        if (cpyWrapWest(epMask) & pawnSet) 
+            tList.push(Move(epSquare - 1, epSquare + pushOffset, enPassant));
     }
 }
 
-void MoveGenerator::enPassants(uint64_t tTarget, std::vector<Move> &tList, const Board &tBoard) const
+// Entry points reached from the header
+template void MoveGenerator::generate<MoveGenerator::allGen>(const Board&, MoveList&) const;
+template void MoveGenerator::generate<MoveGenerator::captureGen>(const Board&, MoveList&) const;
+template void MoveGenerator::generate<MoveGenerator::quietGen>(const Board&, MoveList&) const;
+template void MoveGenerator::generate<MoveGenerator::evasionGen>(const Board&, MoveList&) const;
+template void MoveGenerator::generateLegal<MoveGenerator::allGen>(const Board&, MoveList&) const;
+template void MoveGenerator::generateLegal<MoveGenerator::captureGen>(const Board&, MoveList&) const;
+template void MoveGenerator::generateLegal<MoveGenerator::quietGen>(const Board&, MoveList&) const;
+
+bool MoveGenerator::isAttacked(const Board &tBoard, int tSquare, int tAttackingSide, uint64_t tOccupied) const
 {
-    int stm = tBoard.getSideToMove();
-    uint64_t pawnSet = tBoard.getBitboard(pawn) & tBoard.getBitboard(stm);
+    uint64_t pawnsSet = tBoard.getBitboard(pawn) & tBoard.getBitboard(tAttackingSide);
+    if ((mLookup.pawnAttacks(tSquare, 1-tAttackingSide) & pawnsSet) != 0) return true;
 
-    int epSquare = tBoard.getEpSquare();
-    uint64_t epMask = uint64_t(1) << epSquare;
 
+    const uint64_t enemySet = tBoard.getBitboard(tAttackingSide);
+    const uint64_t diagonals = (tBoard.getBitboard(bishop) | tBoard.getBitboard(queen)) & enemySet;
+    const uint64_t orthogonals = (tBoard.getBitboard(rook) | tBoard.getBitboard(queen)) & enemySet;
 
-    if (stm == white) {
-        if(tTarget & (epMask << 8)){
-            if (cpyWrapEast(epMask) & pawnSet) 
-                tList.emplace_back(Move(epSquare + 1, epSquare + 8, enPassant));
-            if (cpyWrapWest(epMask) & pawnSet) 
-                tList.emplace_back(Move(epSquare - 1, epSquare + 8, enPassant));
-        }
-    }
-    else {
-        if(tTarget & (epMask >> 8)) {
-            if (cpyWrapEast(epMask) & pawnSet) 
-                tList.emplace_back(Move(epSquare + 1, epSquare - 8, enPassant));
-            if (cpyWrapWest(epMask) & pawnSet) 
-                tList.emplace_back(Move(epSquare - 1, epSquare - 8, enPassant));
-        }
-    }
+    return (MagicBitboards::attacks<knight>(tSquare, tOccupied) & tBoard.getBitboard(knight) & enemySet)
+        || (MagicBitboards::attacks<king>(tSquare, tOccupied) & tBoard.getBitboard(king) & enemySet)
+        || (MagicBitboards::attacks<bishop>(tSquare, tOccupied) & diagonals)
+        || (MagicBitboards::attacks<rook>(tSquare, tOccupied) & orthogonals);
 }
 
-bool MoveGenerator::isAttacked(const Board &tBoard, int tSquare, int tAttackingSide) const
+uint64_t MoveGenerator::pinnedPieces(const Board &tBoard, int tSide, int tKingSquare) const
 {
-    uint64_t occupied = tBoard.getBitboard(white) | tBoard.getBitboard(black);
-    uint64_t pawnsSet = tBoard.getBitboard(pawn) & tBoard.getBitboard(tAttackingSide);
-    if ((mLookup.pawnAttacks(tSquare, 1-tAttackingSide) & pawnsSet) != 0) return true;
-
+    const uint64_t enemySet = tBoard.getBitboard(1 - tSide);
+    const uint64_t occupied = tBoard.getBitboard(white) | tBoard.getBitboard(black);
+    const uint64_t diagonals = (tBoard.getBitboard(bishop) | tBoard.getBitboard(queen)) & enemySet;
+    const uint64_t orthogonals = (tBoard.getBitboard(rook) | tBoard.getBitboard(queen)) & enemySet;
+
+    // Enemy sliders that would hit the king if our own pieces weren't there
+    uint64_t snipers = (mLookup.getAttacks(bishop, tKingSquare, enemySet) & diagonals)
+                     | (mLookup.getAttacks(rook, tKingSquare, enemySet) & orthogonals);
+    uint64_t pinned = 0;
+
+    if (snipers) do {
+        const uint64_t blockers = mLookup.betweenSquares(tKingSquare, bitScanForward(snipers)) & occupied;
+        if (blockers && !(blockers & (blockers - 1))) pinned |= blockers & tBoard.getBitboard(tSide);
+    } while (snipers &= (snipers - 1));
+
+    return pinned;
+}
 
-    for (int piece = knight; piece <= king; piece ++){
-        uint64_t pieceSet = tBoard.getBitboard(piece) & tBoard.getBitboard(tAttackingSide);
-        if((mLookup.getAttacks(piece, tSquare, occupied) & pieceSet) != 0) return true;
-    } 
+bool MoveGenerator::isLegalEnPassant(const Board &tBoard, const Move tMove, uint64_t tCheckers) const
+{
+    const int stm = tBoard.getSideToMove();
+    const int kingSquare = tBoard.getKingSquare(stm);
+    const uint64_t capturedSet = uint64_t(1) << tBoard.getEpSquare();
+    const uint64_t occupied = (tBoard.getBitboard(white) | tBoard.getBitboard(black))
+                            ^ (uint64_t(1) << tMove.from()) ^ (uint64_t(1) << tMove.to()) ^ capturedSet;
+    const uint64_t enemySet = tBoard.getBitboard(1 - stm);
+    const uint64_t diagonals = (tBoard.getBitboard(bishop) | tBoard.getBitboard(queen)) & enemySet;
+    const uint64_t orthogonals = (tBoard.getBitboard(rook) | tBoard.getBitboard(queen)) & enemySet;
+
+    // Knight checks can't be solved, a pawn check only if that pawn is the one captured
+    if (tCheckers & ~capturedSet & (tBoard.getBitboard(knight) | tBoard.getBitboard(pawn))) return false;
+    return !(mLookup.getAttacks(bishop, kingSquare, occupied) & diagonals)
+        && !(mLookup.getAttacks(rook, kingSquare, occupied) & orthogonals);
+}
 
-    return false;
+bool MoveGenerator::isLegal(const Board& tBoard, const Move tMove) const
+{
+    const int stm = tBoard.getSideToMove();
+    const int kingSquare = tBoard.getKingSquare(stm);
+    const int from = tMove.from(), to = tMove.to();
+    const uint64_t occupied = tBoard.getBitboard(white) | tBoard.getBitboard(black);
+
+    // validate already checked the squares crossed while castling
+    if (tMove.isCastle()) return true;
+    if (from == kingSquare) return !isAttacked(tBoard, to, 1 - stm, occupied ^ (uint64_t(1) << from));
+
+    const uint64_t checkers = attackersTo(tBoard, kingSquare, occupied) & tBoard.getBitboard(1 - stm);
+    if (tMove.isEnPassant()) return isLegalEnPassant(tBoard, tMove, checkers);
+    if (checkers & (checkers - 1)) return false;
+    if (checkers && !((checkers | mLookup.betweenSquares(kingSquare, bitScanForward(checkers))) & (uint64_t(1) << to)))
+        return false;
+
+    return !(pinnedPieces(tBoard, stm, kingSquare) & (uint64_t(1) << from))
+        || (mLookup.lineThrough(kingSquare, from) & (uint64_t(1) << to));
 }
 
 bool MoveGenerator::validate(const Board& tBoard,const Move tMove) const {
+    const int stm = tBoard.getSideToMove();
+    const uint64_t fromMask = uint64_t(1) << tMove.from();
+    const uint64_t moveMask = uint64_t(1) << tMove.to();
+
+    // Insures the moving piece belongs to the side to move and nothing friendly is captured
+    if (!(tBoard.getBitboard(stm) & fromMask) || (tBoard.getBitboard(stm) & moveMask))
+        return false;
+
     int moved = tBoard.searchPiece(tMove.from());
 
     if (moved == pawn){
-        // Insures that ep is available and the right file is used
+        // Insures that ep is available and the pawn captures onto the ep target square
         if (tMove.isEnPassant())
-            return tBoard.getEpState() && (tBoard.getEpSquare()%8 == tMove.to()%8);
-
-        int stm = tBoard.getSideToMove();
-        uint64_t moveMask = uint64_t(1) << tMove.to();
+            return tBoard.getEpState()
+                && tMove.to() == tBoard.getEpSquare() + (stm == white ? 8 : -8)
+                && (mLookup.pawnAttacks(tMove.from(), stm) & moveMask);
 
         // Insures pawns capture according to their attack pattern and move_to square is occupied
         if (tMove.isCapture())
@@ -251,8 +379,7 @@ bool MoveGenerator::validate(const Board& tBoard,const Move tMove) const {
     
         // Insures pawns don't push trough existing pieces
         uint64_t emptySet = ~(tBoard.getBitboard(white) | tBoard.getBitboard(black));
-        uint64_t moveSet  = uint64_t(1) << tMove.from();
-        moveSet  = (stm == white ? moveSet << 8 : moveSet >> 8) & emptySet;
+        uint64_t moveSet  = (stm == white ? fromMask << 8 : fromMask >> 8) & emptySet;
 
         if (tMove.isDoublePush()) // move_to square correctness doesn't need to be checked
             return (stm == white ? moveSet << 8 : moveSet >> 8) & emptySet;
@@ -264,30 +391,26 @@ bool MoveGenerator::validate(const Board& tBoard,const Move tMove) const {
         if (tMove.isPromo() || tMove.isEnPassant() || tMove.isDoublePush())
             return false; // These flags are pawn exclusive
         
-        int stm = tBoard.getSideToMove();
         uint64_t occupied   = tBoard.getBitboard(white) | tBoard.getBitboard(black);
 
-        auto isKingSafe = [&] (uint64_t mask) {
-            do {
-                int square = bitScanForward(mask);
-                if (isAttacked(tBoard, square, stm))
-                    return false;
-            } while (mask &= (mask - 1));
-            return true;
-        };
-
         if (tMove.isCastle()) {
-            static constexpr std::array<uint64_t, 4> castleSets = {
+            // Squares that must be empty and squares the king crosses, per castle type and color
+            static constexpr std::array<uint64_t, 4> emptySets = {
                 uint64_t(0x0000000000000060), uint64_t(0x000000000000000e),
                 uint64_t(0x6000000000000000), uint64_t(0x0e00000000000000)
             };
-            uint64_t castleMask = castleSets[(tMove.flag() - kingCastle) + (2 * stm)];
-            return (castleMask & ~occupied) && isKingSafe(castleMask);
+            static constexpr std::array<std::array<int, 3>, 4> kingPaths = {{
+                {e1, f1, g1}, {e1, d1, c1}, {e8, f8, g8}, {e8, d8, c8}
+            }};
+            const int castle = (tMove.flag() - kingCastle) + (2 * stm);
+            const bool rights = tMove.flag() == kingCastle ? tBoard.getShortCastle(stm) : tBoard.getLongCastle(stm);
+            if (moved != king || !rights || (emptySets[castle] & occupied)) return false;
+            for (int square : kingPaths[castle]) if (isAttacked(tBoard, square, 1 - stm)) return false;
+            return tMove.to() == kingPaths[castle][2];
         }
         
         // Insures pieces move according to their attack patterns
         uint64_t attackSet = mLookup.getAttacks(moved, tMove.from(), occupied);
-        uint64_t moveMask  = uint64_t(1) << tMove.to();
         bool captureFound  = tBoard.searchPiece(tMove.to());
 
         // Checks that move_to square is occupied iff move is capture
@@ -296,3 +419,71 @@ bool MoveGenerator::validate(const Board& tBoard,const Move tMove) const {
 
     return false;
 }
+
+uint64_t MoveGenerator::attackersTo(const Board& tBoard, int tSquare, uint64_t tOccupied) const
+{
+    const uint64_t diagonals = tBoard.getBitboard(bishop) | tBoard.getBitboard(queen);
+    const uint64_t orthogonals = tBoard.getBitboard(rook) | tBoard.getBitboard(queen);
+    const uint64_t pawns = tBoard.getBitboard(pawn);
+
+    return (mLookup.pawnAttacks(tSquare, black) & pawns & tBoard.getBitboard(white))
+        | (mLookup.pawnAttacks(tSquare, white) & pawns & tBoard.getBitboard(black))
+        | (mLookup.getAttacks(knight, tSquare, tOccupied) & tBoard.getBitboard(knight))
+        | (mLookup.getAttacks(bishop, tSquare, tOccupied) & diagonals)
+        | (mLookup.getAttacks(rook, tSquare, tOccupied) & orthogonals)
+        | (mLookup.getAttacks(king, tSquare, tOccupied) & tBoard.getBitboard(king));
+}
+
+bool MoveGenerator::see(const Board& tBoard, const Move tMove, int tThreshold) const
+{
+    static constexpr std::array<int, 8> seeValue = {0, 0, 100, 300, 300, 500, 1000, 20000};
+
+    // Castles can't lose material, promotions are always worth trying
+    if (tMove.isCastle() || tMove.isPromo()) return 0 >= tThreshold || tMove.isPromo();
+
+    const int from = tMove.from(), to = tMove.to();
+    const int captured = tMove.isEnPassant() ? pawn : tBoard.searchPiece(to);
+
+    // Balance after the move if the opponent doesn't recapture, then if he recaptures for free
+    int swap = seeValue[captured] - tThreshold;
+    if (swap < 0) return false;
+    swap = seeValue[tBoard.searchPiece(from)] - swap;
+    if (swap <= 0) return true;
+
+    uint64_t occupied = (tBoard.getBitboard(white) | tBoard.getBitboard(black)) ^ (uint64_t(1) << from) ^ (uint64_t(1) << to);
+    if (tMove.isEnPassant()) occupied ^= uint64_t(1) << (to + (tBoard.getSideToMove() == white ? -8 : 8));
+
+    const uint64_t diagonals = tBoard.getBitboard(bishop) | tBoard.getBitboard(queen);
+    const uint64_t orthogonals = tBoard.getBitboard(rook) | tBoard.getBitboard(queen);
+    uint64_t attackers = attackersTo(tBoard, to, occupied);
+    int side = tBoard.getSideToMove();
+    bool result = true;
+
+    // Each side recaptures with its least valuable attacker, sliders behind it join as x-rays
+    while (true) {
+        side = 1 - side;
+        attackers &= occupied;
+        const uint64_t sideAttackers = attackers & tBoard.getBitboard(side);
+        if (!sideAttackers) break;
+
+        int piece = pawn;
+        while (!(sideAttackers & tBoard.getBitboard(piece))) piece ++;
+
+        result = !result;
+
+        // A king can only recapture if the square is no longer defended
+        if (piece == king) 
+            return (attackers & tBoard.getBitboard(1 - side)) ? !result : result;
+
+        swap = seeValue[piece] - swap;
+        if (swap < int(result)) break;
+
+        occupied ^= uint64_t(1) << bitScanForward(sideAttackers & tBoard.getBitboard(piece));
+        if (piece == pawn || piece == bishop || piece == queen)
+            attackers |= mLookup.getAttacks(bishop, to, occupied) & diagonals;
+        if (piece == rook || piece == queen)
+            attackers |= mLookup.getAttacks(rook, to, occupied) & orthogonals;
+    }
+
+    return result;
+}
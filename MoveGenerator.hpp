@@ -1,9 +1,9 @@
 #pragma once
 
 #include <cstdint>
-#include <vector>
 
 #include "Move.hpp"
+#include "MoveList.hpp"
 #include "MagicBitboards.hpp"
 #include "Board.hpp"
 #include "notation.hpp"
@@ -12,55 +12,97 @@ class MoveGenerator{
 public:
     MoveGenerator() : mLookup{MagicBitboards::getInstance()} {};
 
+    // Generation stages, each one decides which destination squares are wanted
+    enum genStage {
+        allGen, captureGen, quietGen, evasionGen
+    };
+
     /**
      * @brief Generates all pseudo-legal moves
      *
      * @param tBoard The position from wich moves are computed
-     * @param outList Reference to a vector to wich the moves will be appended
+     * @param outList Reference to a move list to wich the moves will be appended
      * @return Nothing
      */
-    inline void all(const Board& tBoard, std::vector<Move>& outList) const {
-        generate(UINT64_MAX, tBoard, outList);
+    inline void all(const Board& tBoard, MoveList& outList) const {
+        generate<allGen>(tBoard, outList);
     }
 
     /**
      * @brief Generates only pseudo-legal captures
      * 
      * @param tBoard The position from wich moves are computed
-     * @param outList Reference to a vector to wich the moves will be appended
+     * @param outList Reference to a move list to wich the moves will be appended
      * @return Nothing
      */
-    inline void captures(const Board& tBoard, std::vector<Move>& outList) const {
-        uint64_t enemySet = tBoard.getBitboard(1 - tBoard.getSideToMove());
-        generate(enemySet, tBoard, outList);
+    inline void captures(const Board& tBoard, MoveList& outList) const {
+        generate<captureGen>(tBoard, outList);
     }
 
     /**
      * @brief Generates only pseudo-legal quiet moves
      * 
      * @param tBoard The position from wich moves are computed
-     * @param outList Reference to a vector to wich the moves will be appended
+     * @param outList Reference to a move list to wich the moves will be appended
      * @return Nothing
      */
-    inline void quiets(const Board& tBoard, std::vector<Move>& outList) const {
-        uint64_t emptySet = ~(tBoard.getBitboard(white) | tBoard.getBitboard(black));
-        generate(emptySet, tBoard, outList);
+    inline void quiets(const Board& tBoard, MoveList& outList) const {
+        generate<quietGen>(tBoard, outList);
     }
 
     /**
      * @brief Generates pseudo-legal moves that COULD get the king out of check
      * 
      * @param tBoard The position from wich moves are computed
-     * @param outList Reference to a vector to wich the moves will be appended
+     * @param outList Reference to a move list to wich the moves will be appended
      * @return Nothing
      */
-    inline void evasions(const Board& tBoard, std::vector<Move> &outList) const{
-        int kingSquare = tBoard.getKingSquare(tBoard.getSideToMove());
-        uint64_t occupied = tBoard.getBitboard(white) | tBoard.getBitboard(black);
-        uint64_t target = mLookup.getAttacks(queen, kingSquare, occupied) | mLookup.getAttacks(knight, kingSquare, occupied);
-        generate(target, tBoard, outList);        
+    inline void evasions(const Board& tBoard, MoveList& outList) const{
+        generate<evasionGen>(tBoard, outList);
     }
 
+    /**
+     * @brief Generates all legal moves
+     *
+     * @param tBoard The position from wich moves are computed
+     * @param outList Reference to a move list to wich the moves will be appended
+     * @return Nothing
+     */
+    inline void legal(const Board& tBoard, MoveList& outList) const {
+        generateLegal<allGen>(tBoard, outList);
+    }
+
+    /**
+     * @brief Generates only legal captures, when in check only those that resolve it
+     *
+     * @param tBoard The position from wich moves are computed
+     * @param outList Reference to a move list to wich the moves will be appended
+     * @return Nothing
+     */
+    inline void legalCaptures(const Board& tBoard, MoveList& outList) const {
+        generateLegal<captureGen>(tBoard, outList);
+    }
+
+    /**
+     * @brief Generates only legal quiet moves, when in check only those that resolve it
+     *
+     * @param tBoard The position from wich moves are computed
+     * @param outList Reference to a move list to wich the moves will be appended
+     * @return Nothing
+     */
+    inline void legalQuiets(const Board& tBoard, MoveList& outList) const {
+        generateLegal<quietGen>(tBoard, outList);
+    }
+
+    /**
+     * @brief Checks legality of a pseudo-legal move without making it
+     *
+     * @param tBoard The position to reference
+     * @param tMove A move that already passed validate
+     * @return true if the move doesn't leave the king in check
+     */
+    bool isLegal(const Board& tBoard, const Move tMove) const;
+
     /**
      * @brief Checks if a square is attacked
      * 
@@ -69,7 +111,9 @@ public:
      * @param tSide Player color that's attacking
      * @return true if the square is under attack, false otherwise
      */
-    bool isAttacked(const Board &tBoard, int tSquare, int tSide) const;
+    inline bool isAttacked(const Board &tBoard, int tSquare, int tSide) const {
+        return isAttacked(tBoard, tSquare, tSide, tBoard.getBitboard(white) | tBoard.getBitboard(black));
+    }
 
     /**
      * @brief Checks pseudo-legality of a move
@@ -79,13 +123,45 @@ public:
      * @return true if the move is pseudo-legal, false otherwise
      */
     bool validate(const Board& tBoard,const Move tMove) const;
+
+    /**
+     * @brief Static Exchange Evaluation, resolves the capture sequence on the target square
+     * 
+     * @param tBoard The position to reference
+     * @param tMove The move to evaluate
+     * @param tThreshold Minimum material balance, in centipawns, the exchange has to reach
+     * @return true if the exchange nets at least tThreshold for the side to move
+     */
+    bool see(const Board& tBoard, const Move tMove, int tThreshold) const;
+
+    /**
+     * @brief Returns every piece of both colors attacking a square
+     * 
+     * @param tBoard The position to reference
+     * @param tSquare The square in question
+     * @param tOccupied Occupancy used for slider attacks, lets x-rays show up as pieces get removed
+     * @return uint64_t bitboard of the attackers
+     */
+    uint64_t attackersTo(const Board& tBoard, int tSquare, uint64_t tOccupied) const;
 private:
-    void generate (uint64_t tTarget, const Board& tBoard, std::vector<Move>& outList) const;
-    void pieceMoves(uint64_t tTarget, int tPiece, std::vector<Move>& tList, const Board& tBoard) const;
-    void pawnMoves(uint64_t tTarget, std::vector<Move> &tList, const Board &tBoard) const;
+    // Side to move, piece and stage are template parameters so that every branch on them folds away
+    template <int tStage> void generate (const Board& tBoard, MoveList& outList) const;
+    template <int tStage> void generateLegal (const Board& tBoard, MoveList& outList) const;
+    template <int tSide, int tStage> void generate (const Board& tBoard, MoveList& outList) const;
+    template <int tSide, int tStage> void generateLegal (const Board& tBoard, MoveList& outList) const;
+    template <int tSide, int tStage> uint64_t stageTarget(const Board& tBoard) const;
+
+    template <int tPiece, int tStage>
+    void pieceMoves(uint64_t tTarget, uint64_t tPieceSet, MoveList &tList, const Board& tBoard) const;
+    template <int tSide, int tStage>
+    void pawnMoves(uint64_t tTarget, uint64_t tPawnSet, MoveList &tList, const Board &tBoard) const;
     
-    void castles(std::vector<Move> &tList, const Board &tBoard) const; 
-    void enPassants(uint64_t tTarget, std::vector<Move> &tList, const Board &tBoard) const;
+    template <int tSide> void castles(MoveList &tList, const Board &tBoard) const; 
+    template <int tSide> void enPassants(uint64_t tTarget, MoveList &tList, const Board &tBoard) const;
+
+    bool isAttacked(const Board &tBoard, int tSquare, int tSide, uint64_t tOccupied) const;
+    uint64_t pinnedPieces(const Board &tBoard, int tSide, int tKingSquare) const;
+    bool isLegalEnPassant(const Board &tBoard, const Move tMove, uint64_t tCheckers) const;
 private:
     const MagicBitboards& mLookup;
 };
\ No newline at end of file
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+
+#include "Move.hpp"
+
+// Fixed capacity move buffer that lives on the stack, no legal position has more than 218 moves.
+// Each slot also carries a score for move ordering
+class MoveList
+{
+public:
+    static constexpr size_t CAPACITY = 256;
+
+    inline void push(Move tMove) {
+        assert(mSize < CAPACITY);
+        mMoves[mSize ++] = tMove;
+    }
+    inline void pop()   {mSize --;}
+    inline void clear() {mSize = 0;}
+
+    inline size_t size() const {return mSize;}
+    inline bool empty() const  {return mSize == 0;}
+
+    inline Move& operator[](size_t tIndex)             {return mMoves[tIndex];}
+    inline const Move& operator[](size_t tIndex) const {return mMoves[tIndex];}
+    inline Move& back() {return mMoves[mSize - 1];}
+
+    inline int& score(size_t tIndex)             {return mScores[tIndex];}
+    inline const int& score(size_t tIndex) const {return mScores[tIndex];}
+
+    inline Move* begin() {return mMoves.data();}
+    inline Move* end()   {return mMoves.data() + mSize;}
+    inline const Move* begin() const {return mMoves.data();}
+    inline const Move* end()   const {return mMoves.data() + mSize;}
+
+private:
+    std::array<Move, CAPACITY> mMoves;
+    std::array<int, CAPACITY> mScores;
+    size_t mSize = 0;
+};
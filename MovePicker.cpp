@@ -0,0 +1,157 @@
+#include "MovePicker.hpp"
+#include "notation.hpp"
+#include <utility>
+
+MovePicker::MovePicker(const Board &tBoard, const MoveGenerator &tGenerator, MoveList &tBuffer,
+                       Move tTTMove, const std::array<Move, 2> &tKillers, Move tCounter,
+                       const History &tHistory, const std::array<const History::ContTable*, 2> &tCont) :
+    mBoard{tBoard}, mGenerator{tGenerator}, mMoves{tBuffer}, mTTMove{tTTMove}, mKillers{tKillers},
+    mCounter{tCounter}, mHistory{&tHistory}, mCont{tCont}, mStage{ttMoveStage}
+{
+    mMoves.clear();
+}
+
+MovePicker::MovePicker(const Board &tBoard, const MoveGenerator &tGenerator, MoveList &tBuffer, bool tInCheck) :
+    mBoard{tBoard}, mGenerator{tGenerator}, mMoves{tBuffer}, mStage{tInCheck ? initEvasions : initQCaptures}
+{
+    mMoves.clear();
+}
+
+Move MovePicker::next()
+{
+    switch (mStage) {
+    case ttMoveStage:
+        mStage ++;
+        if (mTTMove.isInit() && mGenerator.validate(mBoard, mTTMove) && mGenerator.isLegal(mBoard, mTTMove))
+            return mTTMove;
+        [[fallthrough]];
+
+    case initCaptures:
+        mGenerator.legalCaptures(mBoard, mMoves);
+        scoreCaptures(0, mMoves.size());
+        mStage ++;
+        [[fallthrough]];
+
+    case goodCaptures:
+        while (mCurrent < mMoves.size()) {
+            Move move = selectBest(mMoves.size());
+            if (move == mTTMove) continue;
+            if (mGenerator.see(mBoard, move, 0)) return move;
+            std::swap(mMoves[mBadEnd ++], mMoves[mCurrent - 1]);
+        }
+        mStage ++;
+        [[fallthrough]];
+
+    case firstKiller:
+    case secondKiller:
+        // killers come from sibling nodes, so they must be checked against this position
+        while (mStage <= secondKiller) {
+            Move killer = mKillers[mStage - firstKiller];
+            mStage ++;
+            if (killer.isInit() && killer != mTTMove && !killer.isCapture()
+                && mGenerator.validate(mBoard, killer) && mGenerator.isLegal(mBoard, killer))
+                return killer;
+        }
+        [[fallthrough]];
+
+    case counterMove:
+        mStage ++;
+        if (mCounter.isInit() && mCounter != mTTMove && mCounter != mKillers[0] && mCounter != mKillers[1]
+            && !mCounter.isCapture() && mGenerator.validate(mBoard, mCounter) && mGenerator.isLegal(mBoard, mCounter))
+            return mCounter;
+        [[fallthrough]];
+
+    case initQuiets:
+        mGenerator.legalQuiets(mBoard, mMoves);
+        scoreQuiets(mCurrent, mMoves.size());
+        mStage ++;
+        [[fallthrough]];
+
+    case quietMoves:
+        while (mCurrent < mMoves.size()) {
+            Move move = selectBest(mMoves.size());
+            if (!isRedundant(move)) return move;
+        }
+        mStage ++;
+        [[fallthrough]];
+
+    case badCaptures:
+        if (mBadCurrent < mBadEnd) return mMoves[mBadCurrent ++];
+        mStage = done;
+        return Move();
+
+    case initQCaptures:
+        mGenerator.legalCaptures(mBoard, mMoves);
+        scoreCaptures(0, mMoves.size());
+        mStage ++;
+        [[fallthrough]];
+
+    case qCaptures:
+        if (mCurrent < mMoves.size()) return selectBest(mMoves.size());
+        mStage = done;
+        return Move();
+
+    case initEvasions:
+        mGenerator.legal(mBoard, mMoves);
+        scoreEvasions(0, mMoves.size());
+        mStage ++;
+        [[fallthrough]];
+
+    case evasionMoves:
+        if (mCurrent < mMoves.size()) return selectBest(mMoves.size());
+        mStage = done;
+        return Move();
+
+    default:
+        return Move();
+    }
+}
+
+void MovePicker::scoreCaptures(size_t tBegin, size_t tEnd)
+{
+    // MVV-LVA: most valuable victim first, least valuable attacker to break ties
+    for (size_t i = tBegin; i < tEnd; i ++) {
+        const Move move = mMoves[i];
+        const int victim = move.isEnPassant() ? pawn : mBoard.searchPiece(move.to());
+        mMoves.score(i) = 8 * victim - mBoard.searchPiece(move.from());
+    }
+}
+
+void MovePicker::scoreQuiets(size_t tBegin, size_t tEnd)
+{
+    const int side = mBoard.getSideToMove();
+    for (size_t i = tBegin; i < tEnd; i ++) {
+        const Move move = mMoves[i];
+        const int pieceTo = History::pieceTo(side, mBoard.searchPiece(move.from()), move.to());
+        mMoves.score(i) = mHistory->score(side, move, pieceTo, mCont);
+    }
+}
+
+void MovePicker::scoreEvasions(size_t tBegin, size_t tEnd)
+{
+    for (size_t i = tBegin; i < tEnd; i ++) {
+        const Move move = mMoves[i];
+        if (move.isCapture()) {
+            const int victim = move.isEnPassant() ? pawn : mBoard.searchPiece(move.to());
+            mMoves.score(i) = 8 * victim - mBoard.searchPiece(move.from());
+        }
+        else mMoves.score(i) = 0;
+    }
+}
+
+Move MovePicker::selectBest(size_t tEnd)
+{
+    // partial selection sort: only the part of the list actually searched gets ordered
+    size_t best = mCurrent;
+    for (size_t i = mCurrent + 1; i < tEnd; i ++)
+        if (mMoves.score(i) > mMoves.score(best)) best = i;
+
+    std::swap(mMoves[mCurrent], mMoves[best]);
+    std::swap(mMoves.score(mCurrent), mMoves.score(best));
+    return mMoves[mCurrent ++];
+}
+
+bool MovePicker::isRedundant(Move tMove) const
+{
+    return tMove == mTTMove || tMove == mKillers[0] || tMove == mKillers[1] || tMove == mCounter;
+}
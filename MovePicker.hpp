@@ -0,0 +1,78 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "Board.hpp"
+#include "History.hpp"
+#include "Move.hpp"
+#include "MoveGenerator.hpp"
+#include "MoveList.hpp"
+
+class MovePicker
+{
+public:
+    /**
+     * @brief Builds a picker for the main search: TT move, winning captures, killers, countermove,
+     * quiets by history then losing captures
+     *
+     * @param tBoard The position from wich moves are picked
+     * @param tGenerator Move generator used to fill each stage on demand
+     * @param tBuffer Storage for the generated moves and their scores, cleared here
+     * @param tTTMove Hash move, tried first if legal
+     * @param tKillers Killer moves for the current ply, tried after the captures if legal
+     * @param tCounter Quiet move that last refuted the previous move, tried after the killers if legal
+     * @param tHistory Statistics used to order the remaining quiet moves
+     * @param tCont Continuation tables of the moves played one and two plies before, nullptr if missing
+     */
+    MovePicker(const Board &tBoard, const MoveGenerator &tGenerator, MoveList &tBuffer,
+               Move tTTMove, const std::array<Move, 2> &tKillers, Move tCounter,
+               const History &tHistory, const std::array<const History::ContTable*, 2> &tCont);
+
+    /**
+     * @brief Builds a picker for the quiescence search: captures only, or every evasion when in check
+     *
+     * @param tBoard The position from wich moves are picked
+     * @param tGenerator Move generator used to fill each stage on demand
+     * @param tBuffer Storage for the generated moves and their scores, cleared here
+     * @param tInCheck Whether the side to move is in check
+     */
+    MovePicker(const Board &tBoard, const MoveGenerator &tGenerator, MoveList &tBuffer, bool tInCheck);
+
+    /**
+     * @brief Returns the next legal move, generating the following stage only when needed
+     *
+     * @return Move The best remaining move, or an uninitialized move once every stage is exhausted
+     */
+    Move next();
+
+private:
+    enum stage {
+        ttMoveStage, initCaptures, goodCaptures, firstKiller, secondKiller, counterMove, initQuiets, quietMoves, badCaptures,
+        initQCaptures, qCaptures,
+        initEvasions, evasionMoves,
+        done
+    };
+
+    void scoreCaptures(size_t tBegin, size_t tEnd);
+    void scoreQuiets(size_t tBegin, size_t tEnd);
+    void scoreEvasions(size_t tBegin, size_t tEnd);
+    Move selectBest(size_t tEnd);
+    bool isRedundant(Move tMove) const;
+
+private:
+    const Board &mBoard;
+    const MoveGenerator &mGenerator;
+    MoveList &mMoves;
+
+    Move mTTMove;
+    std::array<Move, 2> mKillers;
+    Move mCounter;
+    const History *mHistory = nullptr;
+    std::array<const History::ContTable*, 2> mCont {};
+
+    int mStage;
+    size_t mCurrent = 0;
+    size_t mBadEnd = 0;     // losing captures are parked at the front of the list
+    size_t mBadCurrent = 0;
+};
@@ -0,0 +1,95 @@
+#include "NNUE.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+NNUE& NNUE::getInstance()
+{
+    static NNUE instance;
+    return instance;
+}
+
+bool NNUE::load(const std::string &tPath)
+{
+    std::ifstream file(tPath, std::ios::binary);
+    if (!file) return false;
+
+    // Reads everything first so that a truncated file leaves the current network untouched
+    static constexpr size_t count = INPUTS * HIDDEN + HIDDEN + 2 * HIDDEN + 1;
+    std::vector<int16_t> buffer(count);
+    if (!file.read(reinterpret_cast<char*>(buffer.data()), count * sizeof(int16_t))) return false;
+
+    auto it = buffer.begin();
+    for (auto &row : mFeatureWeights) {
+        std::copy_n(it, HIDDEN, row.begin());
+        it += HIDDEN;
+    }
+    std::copy_n(it, HIDDEN, mFeatureBiases.begin());
+    it += HIDDEN;
+    std::copy_n(it, 2 * HIDDEN, mOutputWeights.begin());
+    it += 2 * HIDDEN;
+    mOutputBias = *it;
+    mLoaded = true;
+    return true;
+}
+
+bool NNUE::setEnabled(bool tEnabled)
+{
+    mEnabled = tEnabled && mLoaded;
+    return mEnabled;
+}
+
+void NNUE::reset(Accumulator &tAcc) const
+{
+    tAcc.values[white] = mFeatureBiases;
+    tAcc.values[black] = mFeatureBiases;
+}
+
+int16_t NNUE::evaluate(const Accumulator &tAcc, int tSTM) const
+{
+    int32_t output = dotCReLU(tAcc.values[tSTM].data(), mOutputWeights.data())
+                   + dotCReLU(tAcc.values[1 - tSTM].data(), mOutputWeights.data() + HIDDEN);
+    output = (output + mOutputBias) * SCALE / (QA * QB);
+
+    // keeps network scores well away from mate scores
+    return static_cast<int16_t>(std::clamp(output, -10000, 10000));
+}
+
+int32_t NNUE::dotCReLU(const int16_t *tAcc, const int16_t *tWeights)
+{
+#if defined(NNUE_AVX2)
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i max  = _mm256_set1_epi16(QA);
+    __m256i sum = _mm256_setzero_si256();
+    for (int i = 0; i < HIDDEN; i += 16) {
+        __m256i acc = _mm256_load_si256(reinterpret_cast<const __m256i*>(tAcc + i));
+        acc = _mm256_min_epi16(_mm256_max_epi16(acc, zero), max);
+        const __m256i weights = _mm256_load_si256(reinterpret_cast<const __m256i*>(tWeights + i));
+        sum = _mm256_add_epi32(sum, _mm256_madd_epi16(acc, weights));
+    }
+    __m128i sum128 = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    sum128 = _mm_add_epi32(sum128, _mm_shuffle_epi32(sum128, 0x4e));
+    sum128 = _mm_add_epi32(sum128, _mm_shuffle_epi32(sum128, 0xb1));
+    return _mm_cvtsi128_si32(sum128);
+#elif defined(NNUE_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i max  = _mm_set1_epi16(QA);
+    __m128i sum = _mm_setzero_si128();
+    for (int i = 0; i < HIDDEN; i += 8) {
+        __m128i acc = _mm_load_si128(reinterpret_cast<const __m128i*>(tAcc + i));
+        acc = _mm_min_epi16(_mm_max_epi16(acc, zero), max);
+        const __m128i weights = _mm_load_si128(reinterpret_cast<const __m128i*>(tWeights + i));
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(acc, weights));
+    }
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4e));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xb1));
+    return _mm_cvtsi128_si32(sum);
+#else
+    int32_t sum = 0;
+    for (int i = 0; i < HIDDEN; i ++)
+        sum += std::clamp<int32_t>(tAcc[i], 0, QA) * tWeights[i];
+    return sum;
+#endif
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include "notation.hpp"
+
+#if defined(__AVX2__) && !defined(NNUE_SCALAR)
+#define NNUE_AVX2
+#include <immintrin.h>
+#elif defined(__SSE2__) && !defined(NNUE_SCALAR)
+#define NNUE_SSE2
+#include <emmintrin.h>
+#endif
+
+// Perspective network (768 -> 256)x2 -> 1 with clipped ReLU, quantised to int16.
+// One half of the accumulator is seen by white, the other by black
+struct alignas(64) Accumulator {
+    static constexpr int size = 256;
+    std::array<std::array<int16_t, size>, 2> values;
+};
+
+class NNUE
+{
+public:
+    // Deleted methods for singleton pattern
+    NNUE(const NNUE&)             =delete;
+    NNUE& operator=(const NNUE&)  =delete;
+
+    static NNUE& getInstance();
+
+    static constexpr int INPUTS = 768;
+    static constexpr int HIDDEN = Accumulator::size;
+    static constexpr int QA = 255;
+    static constexpr int QB = 64;
+    static constexpr int SCALE = 400;
+
+    /**
+     * @brief Loads a network from a raw little-endian int16 file laid out as
+     * feature weights [768][256], feature biases [256], output weights [512], output bias
+     *
+     * @param tPath Location of the network file
+     * @return true if the file was read in full, the previous network is kept otherwise
+     */
+    bool load(const std::string &tPath);
+
+    /**
+     * @brief Switches the evaluation between the network and the PSTs, only possible once a network is loaded
+     *
+     * @param tEnabled Whether to evaluate with the network
+     * @return true if the network is now in use
+     */
+    bool setEnabled(bool tEnabled);
+
+    inline bool isLoaded() const  {return mLoaded;}
+    inline bool isEnabled() const {return mEnabled;}
+
+    /**
+     * @brief Sets the accumulator to the feature biases, i.e. an empty board
+     */
+    void reset(Accumulator &tAcc) const;
+
+    inline void addPiece(Accumulator &tAcc, int tColor, int tPiece, int tSquare) const {
+        addRow(tAcc.values[white].data(), mFeatureWeights[index(white, tColor, tPiece, tSquare)].data());
+        addRow(tAcc.values[black].data(), mFeatureWeights[index(black, tColor, tPiece, tSquare)].data());
+    }
+    inline void subPiece(Accumulator &tAcc, int tColor, int tPiece, int tSquare) const {
+        subRow(tAcc.values[white].data(), mFeatureWeights[index(white, tColor, tPiece, tSquare)].data());
+        subRow(tAcc.values[black].data(), mFeatureWeights[index(black, tColor, tPiece, tSquare)].data());
+    }
+
+    /**
+     * @brief Runs the output layer on an up to date accumulator
+     *
+     * @param tAcc Accumulator of the position
+     * @param tSTM Side to move, whose half comes first
+     * @return int16_t Score in centipawns from the side to move point of view
+     */
+    int16_t evaluate(const Accumulator &tAcc, int tSTM) const;
+
+private:
+    NNUE() = default;
+
+    // Colours are relative to the perspective and squares are flipped for black
+    static inline int index(int tPerspective, int tColor, int tPiece, int tSquare) {
+        const int square = tPerspective == white ? tSquare : tSquare ^ 56;
+        return (tColor != tPerspective) * 384 + (tPiece - pawn) * 64 + square;
+    }
+
+    static inline void addRow(int16_t *tAcc, const int16_t *tRow) {
+#if defined(NNUE_AVX2)
+        for (int i = 0; i < HIDDEN; i += 16) {
+            const __m256i acc = _mm256_load_si256(reinterpret_cast<const __m256i*>(tAcc + i));
+            const __m256i row = _mm256_load_si256(reinterpret_cast<const __m256i*>(tRow + i));
+            _mm256_store_si256(reinterpret_cast<__m256i*>(tAcc + i), _mm256_add_epi16(acc, row));
+        }
+#elif defined(NNUE_SSE2)
+        for (int i = 0; i < HIDDEN; i += 8) {
+            const __m128i acc = _mm_load_si128(reinterpret_cast<const __m128i*>(tAcc + i));
+            const __m128i row = _mm_load_si128(reinterpret_cast<const __m128i*>(tRow + i));
+            _mm_store_si128(reinterpret_cast<__m128i*>(tAcc + i), _mm_add_epi16(acc, row));
+        }
+#else
+        for (int i = 0; i < HIDDEN; i ++) tAcc[i] += tRow[i];
+#endif
+    }
+
+    static inline void subRow(int16_t *tAcc, const int16_t *tRow) {
+#if defined(NNUE_AVX2)
+        for (int i = 0; i < HIDDEN; i += 16) {
+            const __m256i acc = _mm256_load_si256(reinterpret_cast<const __m256i*>(tAcc + i));
+            const __m256i row = _mm256_load_si256(reinterpret_cast<const __m256i*>(tRow + i));
+            _mm256_store_si256(reinterpret_cast<__m256i*>(tAcc + i), _mm256_sub_epi16(acc, row));
+        }
+#elif defined(NNUE_SSE2)
+        for (int i = 0; i < HIDDEN; i += 8) {
+            const __m128i acc = _mm_load_si128(reinterpret_cast<const __m128i*>(tAcc + i));
+            const __m128i row = _mm_load_si128(reinterpret_cast<const __m128i*>(tRow + i));
+            _mm_store_si128(reinterpret_cast<__m128i*>(tAcc + i), _mm_sub_epi16(acc, row));
+        }
+#else
+        for (int i = 0; i < HIDDEN; i ++) tAcc[i] -= tRow[i];
+#endif
+    }
+
+    static int32_t dotCReLU(const int16_t *tAcc, const int16_t *tWeights);
+
+private:
+    alignas(64) std::array<std::array<int16_t, HIDDEN>, INPUTS> mFeatureWeights {};
+    alignas(64) std::array<int16_t, HIDDEN> mFeatureBiases {};
+    alignas(64) std::array<int16_t, 2 * HIDDEN> mOutputWeights {};
+    int16_t mOutputBias = 0;
+
+    bool mLoaded = false;
+    bool mEnabled = false;
+};
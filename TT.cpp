@@ -1,34 +1,151 @@
 #include "TT.hpp"
+#include <algorithm>
 #include <cassert>
 #include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <thread>
 #include <tuple>
+#include <vector>
 
-TT::TT(int tMBSize)
+#if defined(__linux__)
+#include <sys/mman.h>
+#elif defined(_MSC_VER)
+#include <malloc.h>
+#endif
+
+TT::TT(size_t tMBSize)
 {
-    mSize = tMBSize * 1024 * 1024 / sizeof(TTEntry);
-    mTable = new TTEntry[mSize];
+    allocate(tMBSize);
 }
 
 TT::~TT()
 {
-    delete[] mTable;
+    release();
+}
+
+void TT::resize(size_t tMBSize)
+{
+    release();
+    allocate(tMBSize);
+}
+
+void TT::allocate(size_t tMBSize)
+{
+    static constexpr size_t hugePageSize = 2 * 1024 * 1024;
+    const size_t bytes = tMBSize * 1024 * 1024;
+    mSize = bytes / sizeof(Bucket);
+    mGeneration = 0;
+
+#if defined(__linux__)
+    // Explicit huge pages only work when the system reserved some, otherwise
+    // falls back on 2 MB aligned memory and asks for transparent huge pages
+    if (bytes % hugePageSize == 0) {
+        void* mem = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (mem != MAP_FAILED) {
+            mTable = static_cast<Bucket*>(mem);
+            mMapped = true;
+            clear();
+            return;
+        }
+    }
+    const size_t alignedBytes = (bytes + hugePageSize - 1) / hugePageSize * hugePageSize;
+    mTable = static_cast<Bucket*>(std::aligned_alloc(hugePageSize, alignedBytes));
+    if (mTable) madvise(mTable, alignedBytes, MADV_HUGEPAGE);
+#elif defined(_MSC_VER)
+    mTable = static_cast<Bucket*>(_aligned_malloc(bytes, sizeof(Bucket)));
+#else
+    mTable = static_cast<Bucket*>(std::aligned_alloc(sizeof(Bucket), bytes));
+#endif
+
+    if (!mTable) throw std::bad_alloc();
+    mMapped = false;
+    clear();
 }
 
-void TT::resize(int tMBSize)
+void TT::release()
 {
-    mSize = tMBSize * 1024 * 1024 / sizeof(TTEntry);
-    delete[] mTable;
-    mTable = new TTEntry[mSize];
+    if (!mTable) return;
+#if defined(__linux__)
+    if (mMapped) munmap(mTable, mSize * sizeof(Bucket));
+    else std::free(mTable);
+#elif defined(_MSC_VER)
+    _aligned_free(mTable);
+#else
+    std::free(mTable);
+#endif
+    mTable = nullptr;
+    mSize = 0;
+}
+
+void TT::clear()
+{
+    // Touching every page from several threads also spreads the table over NUMA nodes
+    const size_t threadCount = std::max(1U, std::thread::hardware_concurrency());
+    const size_t chunk = (mSize + threadCount - 1) / threadCount;
+    std::vector<std::thread> threads;
+
+    for (size_t i = 0; i < threadCount; i ++){
+        const size_t start = i * chunk;
+        const size_t count = std::min(chunk, mSize - std::min(mSize, start));
+        if (count == 0) break;
+        threads.emplace_back([this, start, count]{
+            std::memset(static_cast<void*>(mTable + start), 0, count * sizeof(Bucket));
+        });
+    }
+    for (auto &thread : threads) thread.join();
+    mGeneration = 0;
 }
 
 void TT::insert(TTEntry tEntry){
-    size_t index = tEntry.key % mSize;
-    mTable[index] = tEntry;
+    const uint32_t fragment = keyFragment(tEntry.key);
+    Bucket& target = bucket(tEntry.key);
+
+    // Prefers the slot already holding this position, otherwise evicts the one
+    // with the lowest depth, each search of age costing 8 plies of depth
+    int victim = 0, victimValue = INT32_MAX;
+    for (int i = 0; i < bucketSize; i ++){
+        const uint64_t slot = target.slots[i].load(std::memory_order_relaxed);
+        if (slot == 0 || (slot & keyMask) == fragment) {
+            victim = i;
+            break;
+        }
+        const int age = (mGeneration - int(slot >> generationShift)) & generationMask;
+        const int value = int((slot >> depthShift) & depthMax) - 8 * age;
+        if (value < victimValue) {
+            victim = i;
+            victimValue = value;
+        }
+    }
+
+    const uint64_t slot =
+        uint64_t(fragment) |
+        uint64_t(uint16_t(tEntry.hashMove.asInt())) << moveShift |
+        uint64_t(uint16_t(tEntry.score)) << scoreShift |
+        uint64_t(std::min(int(tEntry.depht), depthMax)) << depthShift |
+        uint64_t(tEntry.nodeType & 0x3) << typeShift |
+        uint64_t(mGeneration) << generationShift;
+    target.slots[victim].store(slot, std::memory_order_relaxed);
 }
 
-std::tuple<bool, TTEntry> TT::probe(uint64_t tKey){
-    size_t index = tKey % mSize;
-    TTEntry& entry = mTable[index];
+std::tuple<bool, TTEntry> TT::probe(uint64_t tKey) const{
+    const uint32_t fragment = keyFragment(tKey);
+    const Bucket& target = bucket(tKey);
 
-    return {entry.key == tKey, entry};
-}
\ No newline at end of file
+    for (int i = 0; i < bucketSize; i ++){
+        const uint64_t slot = target.slots[i].load(std::memory_order_relaxed);
+        if (slot != 0 && (slot & keyMask) == fragment) {
+            const int move = (slot >> moveShift) & 0xffff;
+            return {true, TTEntry(
+                tKey,
+                int16_t(slot >> scoreShift),
+                uint8_t((slot >> depthShift) & depthMax),
+                uint8_t((slot >> typeShift) & 0x3),
+                Move((move >> 6) & 0x3f, move & 0x3f, move >> 12)
+            )};
+        }
+    }
+
+    return {false, TTEntry()};
+}
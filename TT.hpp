@@ -1,6 +1,9 @@
 #pragma once
 
 #include "Move.hpp"
+#include "utils.hpp"
+#include <atomic>
+#include <cstddef>
 #include <cstdint>
 #include <tuple>
 
@@ -19,32 +22,80 @@ struct TTEntry{
 class TT {
 public:
     // Constructor
-    explicit TT(int sizeMB);
+    explicit TT(size_t sizeMB);
     ~TT();
-    
+    TT(const TT&)             = delete;
+    TT& operator=(const TT&)  = delete;
+
     /**
      * @brief Drops the current table and allocates a new one of given size
-     * 
+     *
      * @param sizeMB New size of the hash table in MB
      */
-    void resize(int sizeMB);
+    void resize(size_t sizeMB);
+
+    /**
+     * @brief Empties every bucket, splitting the work among all hardware threads
+     */
+    void clear();
+
+    /**
+     * @brief Ages every stored entry by one search, to be called before each new search
+     */
+    inline void newSearch() {mGeneration = (mGeneration + 1) & generationMask;}
 
     /**
-     * @brief Inserts an entry
-     * 
+     * @brief Inserts an entry, replacing the shallowest and oldest slot of its bucket
+     *
      * @param tEntry Position information as specified in the designated struct
      */
     void insert(TTEntry tEntry);
 
     /**
      * @brief Probes the hash table and returns an entry
-     * 
+     *
      * @param tKey Zobrist hash key
      * @return std::tuple<bool, TTEntry> composed of the truth value for probe hit and a TTEntry
      */
-    std::tuple<bool, TTEntry> probe(uint64_t tKey);
+    std::tuple<bool, TTEntry> probe(uint64_t tKey) const;
 
 private:
-    size_t mSize;    // Fixed size of the hash table
-    TTEntry* mTable; // Fixed-size vector of optional entries
-};
\ No newline at end of file
+    static constexpr int bucketSize = 8;
+
+    // Every slot is a single 64 bit word, so concurrent readers and writers can't
+    // observe a torn entry. Slots are arranged like:
+    // [gggggttdddddddssssssssssssssssmmmmmmmmmmmmmmmmkkkkkkkkkkkkkkkkkk]
+    //
+    // Where:
+    // first 18 bits for key fragment   [k]
+    // then  16 bits for hash move      [m]
+    // then  16 bits for score          [s]
+    // then   7 bits for depth          [d]
+    // then   2 bits for node type      [t]
+    // last   5 bits for generation     [g]
+    //
+    // A probe compares the fragment with the 8 slots of a bucket, so a position whose bucket is
+    // full of other positions falsely matches one of them with probability about 8 / 2^18, once
+    // every 32768 probes. Such a hit can't play a wrong move, hash moves are validated before
+    // use in the tree and at the root cutoff, but its score and bound are trusted like any
+    // other entry's, so a false match at the root can still report a legal but unsearched move
+    static constexpr int keyBits = 18, moveShift = 18, scoreShift = 34, depthShift = 50, typeShift = 57, generationShift = 59;
+    static constexpr uint32_t keyMask = (1U << keyBits) - 1;
+    static constexpr int depthMax = 0x7f, generationMask = 0x1f;
+
+    struct alignas(64) Bucket {
+        std::atomic<uint64_t> slots[bucketSize];
+    };
+
+    // Buckets are indexed by the high bits of the key, slots are matched with the low ones
+    inline Bucket& bucket(uint64_t tKey) const {return mTable[mulHi64(tKey, mSize)];}
+    static inline uint32_t keyFragment(uint64_t tKey) {return uint32_t(tKey) & keyMask;}
+
+    void allocate(size_t sizeMB);
+    void release();
+
+    size_t mSize = 0;            // Number of buckets in the hash table
+    Bucket* mTable = nullptr;    // Fixed-size array of buckets
+    bool mMapped = false;        // Table is backed by an explicit huge page mapping
+    uint8_t mGeneration = 0;
+};
@@ -0,0 +1,821 @@
+#include "Tablebases.hpp"
+#include "MappedFile.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <mutex>
+
+// The file format and the indexing scheme are the ones of the Syzygy generator (R. de Man),
+// the decoding follows the layout of the reference probing code
+
+namespace {
+
+constexpr int TB_PIECES = 7;
+
+enum tbFlag {stmFlag = 1, mappedFlag = 2, winPliesFlag = 4, lossPliesFlag = 8, wideFlag = 16, singleValueFlag = 128};
+enum probeState {probeFail, probeOk, probeChangeSTM, probeZeroingBestMove};
+
+// Values are stored with both endiannesses, reading byte by byte also avoids unaligned loads
+inline uint16_t readLE16(const uint8_t *tData) {return uint16_t(tData[0] | tData[1] << 8);}
+inline uint32_t readLE32(const uint8_t *tData) {return readLE16(tData) | uint32_t(readLE16(tData + 2)) << 16;}
+inline uint32_t readBE32(const uint8_t *tData) {
+    return uint32_t(tData[0]) << 24 | uint32_t(tData[1]) << 16 | uint32_t(tData[2]) << 8 | tData[3];
+}
+inline uint64_t readBE64(const uint8_t *tData) {return uint64_t(readBE32(tData)) << 32 | readBE32(tData + 4);}
+
+template <typename T>
+inline int signOf(T tValue) {return (T(0) < tValue) - (tValue < T(0));}
+
+// Squares flips and the distance from the a1-h8 diagonal, negative below it
+inline int flipFile(int tSquare) {return tSquare ^ 7;}
+inline int flipRank(int tSquare) {return tSquare ^ 56;}
+inline int offA1H8(int tSquare) {return (tSquare >> 3) - (tSquare & 7);}
+
+// Piece codes of the files: 1..6 for the white pawn..king, 9..14 for black
+inline int tbPiece(int tColor, int tPiece) {return tColor * 8 + tPiece - 1;}
+
+// DTZ tables don't store captures and pawn moves, their value follows from the WDL outcome
+inline int dtzBeforeZeroing(wdlScore tWDL) {
+    return tWDL == wdlWin         ?  1   :
+           tWDL == wdlCursedWin   ?  101 :
+           tWDL == wdlBlessedLoss ? -101 :
+           tWDL == wdlLoss        ? -1   : 0;
+}
+
+// Indexing tables shared by every file
+struct Encoding {
+    int mapPawns[64] {};
+    int mapB1H1H7[64] {};
+    int mapA1D1D4[64] {};
+    int mapKK[10][64] {};
+    int binomial[6][64] {};         // ways of choosing k elements out of n
+    int leadPawnIdx[6][64] {};      // by number of leading pawns and square of the first one
+    int leadPawnsSize[6][4] {};     // by number of leading pawns and file a..d
+
+    Encoding() {
+        // b1-h1-h7 triangle to 0..27
+        int code = 0;
+        for (int square = a1; square <= h8; square ++)
+            if (offA1H8(square) < 0) mapB1H1H7[square] = code ++;
+
+        // a1-d1-d4 triangle to 0..9, squares on the diagonal last
+        std::vector<int> diagonal;
+        code = 0;
+        for (int square = a1; square <= d4; square ++) {
+            if (offA1H8(square) < 0 && (square & 7) <= 3) mapA1D1D4[square] = code ++;
+            else if (!offA1H8(square) && (square & 7) <= 3) diagonal.push_back(square);
+        }
+        for (int square : diagonal) mapA1D1D4[square] = code ++;
+
+        // The 462 legal placements of two kings with the first one in the a1-d1-d4 triangle,
+        // when the first king is on the diagonal the second one can't be above it
+        std::vector<std::pair<int, int>> bothOnDiagonal;
+        code = 0;
+        for (int idx = 0; idx < 10; idx ++)
+            for (int s1 = a1; s1 <= d4; s1 ++) {
+                if (mapA1D1D4[s1] != idx || (!idx && s1 != b1)) continue;
+                for (int s2 = a1; s2 <= h8; s2 ++) {
+                    const bool touching = std::abs((s1 & 7) - (s2 & 7)) <= 1 && std::abs((s1 >> 3) - (s2 >> 3)) <= 1;
+                    if (touching) continue;
+                    else if (!offA1H8(s1) && offA1H8(s2) > 0) continue;
+                    else if (!offA1H8(s1) && !offA1H8(s2)) bothOnDiagonal.emplace_back(idx, s2);
+                    else mapKK[idx][s2] = code ++;
+                }
+            }
+        for (auto [idx, square] : bothOnDiagonal) mapKK[idx][square] = code ++;
+
+        binomial[0][0] = 1;
+        for (int n = 1; n < 64; n ++)
+            for (int k = 0; k < 6 && k <= n; k ++)
+                binomial[k][n] = (k > 0 ? binomial[k - 1][n - 1] : 0) + (k < n ? binomial[k][n - 1] : 0);
+
+        // Pawns are numbered from the edges inwards and from rank 2 upwards, the leading pawn
+        // of a group is the one with the highest number
+        int availableSquares = 47;
+        for (int leadPawns = 1; leadPawns <= 5; leadPawns ++)
+            for (int file = 0; file <= 3; file ++) {
+                int idx = 0;
+                for (int rank = 1; rank <= 6; rank ++) {
+                    const int square = rank * 8 + file;
+                    if (leadPawns == 1) {
+                        mapPawns[square] = availableSquares --;
+                        mapPawns[flipFile(square)] = availableSquares --;
+                    }
+                    leadPawnIdx[leadPawns][square] = idx;
+                    idx += binomial[leadPawns - 1][mapPawns[square]];
+                }
+                leadPawnsSize[leadPawns][file] = idx;
+            }
+    }
+};
+
+const Encoding encoding;
+
+// Low level decoding data of one sub-table: WDL tables have one per side to move unless symmetric,
+// DTZ tables a single one, and both are split by file of the leading pawn when there are pawns
+struct PairsData {
+    uint8_t flags = 0;
+    uint8_t maxSymLen = 0;
+    uint8_t minSymLen = 0;              // also the stored value of single valued tables
+    uint32_t numBlocks = 0;
+    size_t blockSize = 0;
+    size_t span = 0;                    // positions between two sparse index entries
+    const uint8_t *lowestSym = nullptr; // lowest symbol of each code length, LE16
+    const uint8_t *btree = nullptr;     // left and right children of every symbol, 12 bits each
+    const uint8_t *blockLength = nullptr; // values stored in each block minus one, LE16
+    uint32_t blockLengthSize = 0;
+    const uint8_t *sparseIndex = nullptr; // block LE32 and offset LE16 of every span-th value
+    size_t sparseIndexSize = 0;
+    const uint8_t *data = nullptr;      // Huffman compressed blocks
+    std::vector<uint64_t> base64;       // lowest code of each length, left aligned on 64 bits
+    std::vector<uint8_t> symLen;        // values expanded by each symbol minus one
+    int pieces[TB_PIECES] {};
+    uint64_t groupIdx[TB_PIECES + 1] {};
+    int groupLen[TB_PIECES + 1] {};
+    uint16_t mapIdx[4] {};              // DTZ value maps of wins, losses, cursed wins, blessed losses
+
+    inline int left(int tSym) const  {return (btree[3 * tSym + 1] & 0xf) << 8 | btree[3 * tSym];}
+    inline int right(int tSym) const {return btree[3 * tSym + 2] << 4 | btree[3 * tSym + 1] >> 4;}
+};
+
+}
+
+// One material configuration, e.g. KRvK, with its WDL and DTZ files
+struct TBTable {
+    std::string name;
+    uint64_t key = 0;       // material with the stronger side as white
+    uint64_t key2 = 0;      // same with colours swapped
+    int pieceCount = 0;
+    bool hasPawns = false;
+    bool hasUniquePieces = false;
+    uint8_t pawnCount[2] {};  // leading colour, the other one
+
+    std::atomic<bool> ready[2] {false, false};  // [WDL, DTZ]
+    MappedFile file[2];
+    PairsData wdl[2][4];    // [side to move][file]
+    PairsData dtz[4];       // [file]
+    const uint8_t *dtzMap = nullptr;
+
+    inline PairsData* get(bool tDTZ, int tSTM, int tFile) {
+        return tDTZ ? &dtz[hasPawns ? tFile : 0] : &wdl[tSTM][hasPawns ? tFile : 0];
+    }
+};
+
+namespace {
+
+// Material signature: a nibble per piece type and colour, kings excluded
+uint64_t keyOf(const int tCounts[2][8])
+{
+    uint64_t key = 0;
+    for (int color = white; color <= black; color ++)
+        for (int piece = pawn; piece <= queen; piece ++)
+            key |= uint64_t(tCounts[color][piece]) << (4 * (color * 5 + piece - pawn));
+    return key;
+}
+
+// Parses names like KRPvKN, returns false for anything else
+bool parseName(const std::string &tName, int tCounts[2][8])
+{
+    static const std::string pieceChars = "  PNBRQK";
+    const size_t separator = tName.find('v');
+    if (separator == std::string::npos || tName.size() > TB_PIECES + 1) return false;
+    const std::string sides[2] = {tName.substr(0, separator), tName.substr(separator + 1)};
+    for (int color = white; color <= black; color ++) {
+        if (sides[color].empty() || sides[color][0] != 'K') return false;
+        for (char c : sides[color]) {
+            const size_t piece = pieceChars.find(c);
+            if (c == ' ' || piece == std::string::npos) return false;
+            tCounts[color][piece] ++;
+        }
+        if (tCounts[color][king] != 1) return false;
+    }
+    return true;
+}
+
+// Groups pieces encoded together: the leading group holds the pawns of the leading colour, or the
+// three unique pieces (two kings if there are not enough), every other group pieces of one kind
+void setGroups(const TBTable &tTable, PairsData *tData, const int tOrder[2], int tFile)
+{
+    int n = 0, firstLen = tTable.hasPawns ? 0 : tTable.hasUniquePieces ? 3 : 2;
+    tData->groupLen[n] = 1;
+
+    for (int i = 1; i < tTable.pieceCount; i ++) {
+        if (--firstLen > 0 || tData->pieces[i] == tData->pieces[i - 1]) tData->groupLen[n] ++;
+        else tData->groupLen[++n] = 1;
+    }
+    tData->groupLen[++n] = 0;
+
+    // The order in which groups are combined into the index is given by the file
+    const bool bothPawns = tTable.hasPawns && tTable.pawnCount[1];
+    int next = bothPawns ? 2 : 1;
+    int freeSquares = 64 - tData->groupLen[0] - (bothPawns ? tData->groupLen[1] : 0);
+    uint64_t idx = 1;
+
+    for (int k = 0; next < n || k == tOrder[0] || k == tOrder[1]; k ++) {
+        if (k == tOrder[0]) {
+            tData->groupIdx[0] = idx;
+            idx *= tTable.hasPawns ? encoding.leadPawnsSize[tData->groupLen[0]][tFile]
+                 : tTable.hasUniquePieces ? 31332 : 462;
+        }
+        else if (k == tOrder[1]) {
+            tData->groupIdx[1] = idx;
+            idx *= encoding.binomial[tData->groupLen[1]][48 - tData->groupLen[0]];
+        }
+        else {
+            tData->groupIdx[next] = idx;
+            idx *= encoding.binomial[tData->groupLen[next]][freeSquares];
+            freeSquares -= tData->groupLen[next ++];
+        }
+    }
+    tData->groupIdx[n] = idx;
+}
+
+// Number of values each symbol of the recursive pairing expands into
+uint8_t setSymLen(PairsData *tData, int tSym, std::vector<bool> &tVisited)
+{
+    tVisited[tSym] = true;
+    const int right = tData->right(tSym);
+    if (right == 0xfff) return 0;
+
+    const int left = tData->left(tSym);
+    if (!tVisited[left])  tData->symLen[left]  = setSymLen(tData, left, tVisited);
+    if (!tVisited[right]) tData->symLen[right] = setSymLen(tData, right, tVisited);
+    return tData->symLen[left] + tData->symLen[right] + 1;
+}
+
+const uint8_t* setSizes(PairsData *tData, const uint8_t *tBuffer)
+{
+    tData->flags = *tBuffer ++;
+    if (tData->flags & singleValueFlag) {
+        tData->numBlocks = 0;
+        tData->span = tData->blockLengthSize = tData->sparseIndexSize = 0;
+        tData->minSymLen = *tBuffer ++;
+        return tBuffer;
+    }
+
+    // The last group index is the number of positions of the table
+    const uint64_t tbSize = tData->groupIdx[std::find(tData->groupLen, tData->groupLen + TB_PIECES, 0) - tData->groupLen];
+
+    tData->blockSize = size_t(1) << *tBuffer ++;
+    tData->span = size_t(1) << *tBuffer ++;
+    tData->sparseIndexSize = size_t((tbSize + tData->span - 1) / tData->span);
+    const uint8_t padding = *tBuffer ++;
+    tData->numBlocks = readLE32(tBuffer);
+    tBuffer += 4;
+    tData->blockLengthSize = tData->numBlocks + padding;
+    tData->maxSymLen = *tBuffer ++;
+    tData->minSymLen = *tBuffer ++;
+    tData->lowestSym = tBuffer;
+    tData->base64.assign(tData->maxSymLen - tData->minSymLen + 1, 0);
+
+    // Canonical Huffman code: longer codes have lower values, so base64[i] >= base64[i + 1]
+    for (int i = int(tData->base64.size()) - 2; i >= 0; i --)
+        tData->base64[i] = (tData->base64[i + 1] + readLE16(tData->lowestSym + 2 * i) - readLE16(tData->lowestSym + 2 * (i + 1))) / 2;
+    for (size_t i = 0; i < tData->base64.size(); i ++)
+        tData->base64[i] <<= 64 - i - tData->minSymLen;
+
+    tBuffer += tData->base64.size() * 2;
+    tData->symLen.assign(readLE16(tBuffer), 0);
+    tBuffer += 2;
+    tData->btree = tBuffer;
+
+    std::vector<bool> visited(tData->symLen.size());
+    for (size_t sym = 0; sym < tData->symLen.size(); sym ++)
+        if (!visited[sym]) tData->symLen[sym] = setSymLen(tData, int(sym), visited);
+
+    return tBuffer + tData->symLen.size() * 3 + (tData->symLen.size() & 1);
+}
+
+const uint8_t* setDTZMap(TBTable &tTable, const uint8_t *tBuffer, int tMaxFile)
+{
+    tTable.dtzMap = tBuffer;
+    for (int file = 0; file <= tMaxFile; file ++) {
+        PairsData *data = tTable.get(true, 0, file);
+        if (!(data->flags & mappedFlag)) continue;
+        if (data->flags & wideFlag) {
+            tBuffer += uintptr_t(tBuffer) & 1;
+            for (int i = 0; i < 4; i ++) {
+                data->mapIdx[i] = uint16_t((tBuffer - tTable.dtzMap) / 2 + 1);
+                tBuffer += 2 * readLE16(tBuffer) + 2;
+            }
+        }
+        else {
+            for (int i = 0; i < 4; i ++) {
+                data->mapIdx[i] = uint16_t(tBuffer - tTable.dtzMap + 1);
+                tBuffer += *tBuffer + 1;
+            }
+        }
+    }
+    return tBuffer + (uintptr_t(tBuffer) & 1);
+}
+
+// Reads the headers of a freshly mapped file, the data past them is never copied
+void setup(TBTable &tTable, const uint8_t *tBuffer, bool tDTZ)
+{
+    tBuffer ++; // split and pawn flags, already known from the name
+
+    const int sides = !tDTZ && tTable.key != tTable.key2 ? 2 : 1;
+    const int maxFile = tTable.hasPawns ? 3 : 0;
+    const bool bothPawns = tTable.hasPawns && tTable.pawnCount[1];
+
+    for (int file = 0; file <= maxFile; file ++) {
+        for (int i = 0; i < sides; i ++) *tTable.get(tDTZ, i, file) = PairsData();
+
+        const int order[2][2] = {{tBuffer[0] & 0xf, bothPawns ? tBuffer[1] & 0xf : 0xf},
+                                 {tBuffer[0] >> 4,  bothPawns ? tBuffer[1] >> 4  : 0xf}};
+        tBuffer += 1 + bothPawns;
+
+        for (int k = 0; k < tTable.pieceCount; k ++, tBuffer ++)
+            for (int i = 0; i < sides; i ++)
+                tTable.get(tDTZ, i, file)->pieces[k] = i ? *tBuffer >> 4 : *tBuffer & 0xf;
+
+        for (int i = 0; i < sides; i ++) setGroups(tTable, tTable.get(tDTZ, i, file), order[i], file);
+    }
+    tBuffer += uintptr_t(tBuffer) & 1;
+
+    for (int file = 0; file <= maxFile; file ++)
+        for (int i = 0; i < sides; i ++) tBuffer = setSizes(tTable.get(tDTZ, i, file), tBuffer);
+
+    if (tDTZ) tBuffer = setDTZMap(tTable, tBuffer, maxFile);
+
+    for (int file = 0; file <= maxFile; file ++)
+        for (int i = 0; i < sides; i ++) {
+            PairsData *data = tTable.get(tDTZ, i, file);
+            data->sparseIndex = tBuffer;
+            tBuffer += data->sparseIndexSize * 6;
+        }
+    for (int file = 0; file <= maxFile; file ++)
+        for (int i = 0; i < sides; i ++) {
+            PairsData *data = tTable.get(tDTZ, i, file);
+            data->blockLength = tBuffer;
+            tBuffer += data->blockLengthSize * 2;
+        }
+    for (int file = 0; file <= maxFile; file ++)
+        for (int i = 0; i < sides; i ++) {
+            PairsData *data = tTable.get(tDTZ, i, file);
+            tBuffer = reinterpret_cast<const uint8_t*>((uintptr_t(tBuffer) + 0x3f) & ~uintptr_t(0x3f));
+            data->data = tBuffer;
+            tBuffer += size_t(data->numBlocks) * data->blockSize;
+        }
+}
+
+// Value at the given index: finds its block through the sparse index, then walks the Huffman
+// symbols of the block and expands the one holding the index down to a leaf
+int decompressPairs(const PairsData *tData, uint64_t tIdx)
+{
+    if (tData->flags & singleValueFlag) return tData->minSymLen;
+
+    const uint32_t k = uint32_t(tIdx / tData->span);
+    const uint8_t *entry = tData->sparseIndex + 6 * size_t(k);
+    uint32_t block = readLE32(entry);
+    int offset = readLE16(entry + 4);
+
+    // The sparse entry points at the middle of its span
+    offset += int(tIdx % tData->span) - int(tData->span / 2);
+    while (offset < 0) offset += readLE16(tData->blockLength + 2 * size_t(-- block)) + 1;
+    while (offset > readLE16(tData->blockLength + 2 * size_t(block)))
+        offset -= readLE16(tData->blockLength + 2 * size_t(block ++)) + 1;
+
+    const uint8_t *ptr = tData->data + size_t(block) * tData->blockSize;
+    uint64_t buffer = readBE64(ptr);
+    ptr += 8;
+    int bufferSize = 64;
+    int sym;
+
+    while (true) {
+        int len = 0;
+        while (buffer < tData->base64[len]) len ++;
+
+        sym = int((buffer - tData->base64[len]) >> (64 - len - tData->minSymLen));
+        sym += readLE16(tData->lowestSym + 2 * len);
+
+        if (offset < tData->symLen[sym] + 1) break;
+
+        offset -= tData->symLen[sym] + 1;
+        len += tData->minSymLen;
+        buffer <<= len;
+        bufferSize -= len;
+        if (bufferSize <= 32) {
+            bufferSize += 32;
+            buffer |= uint64_t(readBE32(ptr)) << (64 - bufferSize);
+            ptr += 4;
+        }
+    }
+
+    // Children of a pair are adjacent, so the offset tells which side holds the value
+    while (tData->symLen[sym]) {
+        const int left = tData->left(sym);
+        if (offset < tData->symLen[left] + 1) sym = left;
+        else {
+            offset -= tData->symLen[left] + 1;
+            sym = tData->right(sym);
+        }
+    }
+    return tData->left(sym);
+}
+
+// DTZ values are stored in moves or remapped by frequency, brings them back to plies
+int mapScore(TBTable &tTable, int tFile, int tValue, wdlScore tWDL, bool tDTZ)
+{
+    if (!tDTZ) return tValue - 2;
+
+    static constexpr int wdlMap[] = {1, 3, 0, 2, 0};
+    const PairsData *data = tTable.get(true, 0, tFile);
+    if (data->flags & mappedFlag) {
+        const uint16_t idx = data->mapIdx[wdlMap[tWDL + 2]];
+        tValue = data->flags & wideFlag ? readLE16(tTable.dtzMap + 2 * (size_t(idx) + tValue))
+                                        : tTable.dtzMap[idx + tValue];
+    }
+
+    if ((tWDL == wdlWin && !(data->flags & winPliesFlag)) || (tWDL == wdlLoss && !(data->flags & lossPliesFlag))
+        || tWDL == wdlCursedWin || tWDL == wdlBlessedLoss)
+        tValue *= 2;
+
+    return tValue + 1;
+}
+
+// Computes the index of a position within its table and decodes the stored value
+int probeIndex(TBTable &tTable, const Board &tBoard, uint64_t tKey, wdlScore tWDL, bool tDTZ, int &tState)
+{
+    int squares[TB_PIECES];
+    int pieces[TB_PIECES];
+    int size = 0, leadPawnsCount = 0, tbFile = 0;
+    uint64_t leadPawns = 0, idx;
+
+    // Tables are stored with the stronger side as white and, when symmetric, white to move only.
+    // Other positions get their colours swapped and their board flipped
+    const bool symmetricBlackToMove = tTable.key == tTable.key2 && tBoard.getSideToMove() == black;
+    const bool blackStronger = tKey != tTable.key;
+    const bool flip = symmetricBlackToMove || blackStronger;
+    const int flipColor = flip * 8;
+    const int flipSquares = flip * 56;
+    const int stm = flip ^ tBoard.getSideToMove();
+
+    auto pawnsComp = [](int a, int b) {return encoding.mapPawns[a] < encoding.mapPawns[b];};
+
+    // The leading pawn is the most advanced one towards the edges, its file selects the sub-table
+    if (tTable.hasPawns) {
+        const int leadColor = (tTable.get(false, 0, 0)->pieces[0] ^ flipColor) >> 3;
+        uint64_t b = leadPawns = tBoard.getBitboard(pawn) & tBoard.getBitboard(leadColor);
+        while (b) {
+            squares[size ++] = bitScanForward(b) ^ flipSquares;
+            b &= b - 1;
+        }
+        leadPawnsCount = size;
+        std::swap(squares[0], *std::max_element(squares, squares + leadPawnsCount, pawnsComp));
+        tbFile = std::min(squares[0] & 7, 7 - (squares[0] & 7));
+    }
+
+    // DTZ tables only store one side to move
+    if (tDTZ) {
+        const uint8_t flags = tTable.get(true, 0, tbFile)->flags;
+        if ((flags & stmFlag) != stm && !(tTable.key == tTable.key2 && !tTable.hasPawns)) {
+            tState = probeChangeSTM;
+            return 0;
+        }
+    }
+
+    uint64_t b = (tBoard.getBitboard(white) | tBoard.getBitboard(black)) ^ leadPawns;
+    while (b) {
+        const int square = bitScanForward(b);
+        const int color = (tBoard.getBitboard(black) >> square) & 1;
+        squares[size] = square ^ flipSquares;
+        pieces[size ++] = tbPiece(color, tBoard.searchPiece(square)) ^ flipColor;
+        b &= b - 1;
+    }
+
+    PairsData *data = tTable.get(tDTZ, stm, tbFile);
+
+    // Same piece sequence as the one of the table
+    for (int i = leadPawnsCount; i < size - 1; i ++)
+        for (int j = i + 1; j < size; j ++)
+            if (data->pieces[i] == pieces[j]) {
+                std::swap(pieces[i], pieces[j]);
+                std::swap(squares[i], squares[j]);
+                break;
+            }
+
+    // The leading piece goes to the a..d files
+    if ((squares[0] & 7) > 3)
+        for (int i = 0; i < size; i ++) squares[i] = flipFile(squares[i]);
+
+    if (tTable.hasPawns) {
+        idx = encoding.leadPawnIdx[leadPawnsCount][squares[0]];
+        std::stable_sort(squares + 1, squares + leadPawnsCount, pawnsComp);
+        for (int i = 1; i < leadPawnsCount; i ++) idx += encoding.binomial[i][encoding.mapPawns[squares[i]]];
+    }
+    else {
+        // Without pawns the leading piece also goes below rank 5 and below the a1-h8 diagonal
+        if ((squares[0] >> 3) > 3)
+            for (int i = 0; i < size; i ++) squares[i] = flipRank(squares[i]);
+
+        for (int i = 0; i < data->groupLen[0]; i ++) {
+            if (!offA1H8(squares[i])) continue;
+            if (offA1H8(squares[i]) > 0)
+                for (int j = i; j < size; j ++) squares[j] = ((squares[j] >> 3) | (squares[j] << 3)) & 63;
+            break;
+        }
+
+        if (tTable.hasUniquePieces) {
+            const int adjust1 = squares[1] > squares[0];
+            const int adjust2 = (squares[2] > squares[0]) + (squares[2] > squares[1]);
+
+            if (offA1H8(squares[0]))
+                idx = (encoding.mapA1D1D4[squares[0]] * 63 + (squares[1] - adjust1)) * 62 + squares[2] - adjust2;
+            else if (offA1H8(squares[1]))
+                idx = (6 * 63 + (squares[0] >> 3) * 28 + encoding.mapB1H1H7[squares[1]]) * 62 + squares[2] - adjust2;
+            else if (offA1H8(squares[2]))
+                idx = 6 * 63 * 62 + 4 * 28 * 62 + (squares[0] >> 3) * 7 * 28
+                    + ((squares[1] >> 3) - adjust1) * 28 + encoding.mapB1H1H7[squares[2]];
+            else
+                idx = 6 * 63 * 62 + 4 * 28 * 62 + 4 * 7 * 28 + (squares[0] >> 3) * 7 * 6
+                    + ((squares[1] >> 3) - adjust1) * 6 + ((squares[2] >> 3) - adjust2);
+        }
+        else idx = encoding.mapKK[encoding.mapA1D1D4[squares[0]]][squares[1]];
+    }
+
+    // Remaining groups, each piece skipping the squares taken by the previous groups
+    idx *= data->groupIdx[0];
+    int *groupSq = squares + data->groupLen[0];
+    bool remainingPawns = tTable.hasPawns && tTable.pawnCount[1];
+
+    for (int next = 1; data->groupLen[next]; next ++) {
+        std::stable_sort(groupSq, groupSq + data->groupLen[next]);
+        uint64_t n = 0;
+        for (int i = 0; i < data->groupLen[next]; i ++) {
+            const int adjust = int(std::count_if(squares, groupSq, [&](int s) {return groupSq[i] > s;}));
+            n += encoding.binomial[i + 1][groupSq[i] - adjust - 8 * remainingPawns];
+        }
+        remainingPawns = false;
+        idx += n * data->groupIdx[next];
+        groupSq += data->groupLen[next];
+    }
+
+    return mapScore(tTable, tbFile, decompressPairs(data, idx), tWDL, tDTZ);
+}
+
+}
+
+Tablebases& Tablebases::getInstance()
+{
+    static Tablebases instance;
+    return instance;
+}
+
+Tablebases::Tablebases() = default;
+
+Tablebases::~Tablebases() = default;
+
+int Tablebases::init(const std::string &tPaths)
+{
+    mTables.clear();
+    mByMaterial.clear();
+    mPaths.clear();
+    mLargest = 0;
+
+    if (tPaths.empty() || tPaths == "<empty>") return 0;
+
+#if defined(_WIN32)
+    constexpr char separator = ';';
+#else
+    constexpr char separator = ':';
+#endif
+    size_t start = 0;
+    while (start <= tPaths.size()) {
+        const size_t end = std::min(tPaths.find(separator, start), tPaths.size());
+        if (end > start) mPaths.push_back(tPaths.substr(start, end - start));
+        start = end + 1;
+    }
+
+    // Only WDL files are looked for, a missing DTZ file just fails its probes
+    for (const std::string &path : mPaths) {
+        std::error_code error;
+        for (const auto &entry : std::filesystem::directory_iterator(path, error)) {
+            if (entry.path().extension() != ".rtbw") continue;
+            const std::string name = entry.path().stem().string();
+            int counts[2][8] {};
+            if (!parseName(name, counts)) continue;
+            const int swapped[2][8] = {
+                {counts[black][0], counts[black][1], counts[black][2], counts[black][3], counts[black][4],
+                 counts[black][5], counts[black][6], counts[black][7]},
+                {counts[white][0], counts[white][1], counts[white][2], counts[white][3], counts[white][4],
+                 counts[white][5], counts[white][6], counts[white][7]}};
+            if (mByMaterial.count(keyOf(counts))) continue;
+
+            auto table = std::make_unique<TBTable>();
+            table->name = name;
+            table->key = keyOf(counts);
+            table->key2 = keyOf(swapped);
+            table->pieceCount = int(name.size()) - 1;
+            table->hasPawns = counts[white][pawn] || counts[black][pawn];
+            for (int color = white; color <= black; color ++)
+                for (int piece = pawn; piece <= queen; piece ++)
+                    if (counts[color][piece] == 1) table->hasUniquePieces = true;
+
+            // The side with fewer pawns leads, it compresses better
+            const bool whiteLeads = !counts[black][pawn] || (counts[white][pawn] && counts[black][pawn] >= counts[white][pawn]);
+            table->pawnCount[0] = uint8_t(counts[whiteLeads ? white : black][pawn]);
+            table->pawnCount[1] = uint8_t(counts[whiteLeads ? black : white][pawn]);
+
+            mByMaterial[table->key] = table.get();
+            mByMaterial[table->key2] = table.get();
+            mLargest = std::max(mLargest, table->pieceCount);
+            mTables.push_back(std::move(table));
+        }
+    }
+    return int(mTables.size());
+}
+
+bool Tablebases::map(TBTable &tTable, bool tDTZ)
+{
+    static std::mutex mutex;
+
+    if (tTable.ready[tDTZ].load(std::memory_order_acquire)) return tTable.file[tDTZ].isOpen();
+
+    const std::lock_guard guard(mutex);
+    if (tTable.ready[tDTZ].load(std::memory_order_relaxed)) return tTable.file[tDTZ].isOpen();
+
+    static constexpr uint8_t magics[2][4] = {{0x71, 0xe8, 0x23, 0x5d}, {0xd7, 0x66, 0x0c, 0xa5}};
+    MappedFile &file = tTable.file[tDTZ];
+    for (const std::string &path : mPaths)
+        if (file.open(path + "/" + tTable.name + (tDTZ ? ".rtbz" : ".rtbw"), true)) break;
+
+    if (file.isOpen()) {
+        // Every valid file is 16 bytes past a multiple of 64 and starts with its magic number
+        if (file.size() % 64 != 16 || std::memcmp(file.data(), magics[tDTZ], 4)) {
+            std::cout << "info string corrupted tablebase " << tTable.name << std::endl;
+            file.close();
+        }
+        else setup(tTable, file.data() + 4, tDTZ);
+    }
+
+    tTable.ready[tDTZ].store(true, std::memory_order_release);
+    return file.isOpen();
+}
+
+uint64_t Tablebases::materialKey(const Board &tBoard) const
+{
+    int counts[2][8] {};
+    for (int color = white; color <= black; color ++)
+        for (int piece = pawn; piece <= queen; piece ++)
+            counts[color][piece] = popCount(tBoard.getBitboard(color) & tBoard.getBitboard(piece));
+    return keyOf(counts);
+}
+
+template <bool tDTZ>
+int Tablebases::probeTable(const Board &tBoard, int &tState, wdlScore tWDL)
+{
+    if (popCount(tBoard.getBitboard(white) | tBoard.getBitboard(black)) == 2) return wdlDraw; // KvK
+
+    const uint64_t key = materialKey(tBoard);
+    const auto it = mByMaterial.find(key);
+    if (it == mByMaterial.end() || !map(*it->second, tDTZ)) {
+        tState = probeFail;
+        return 0;
+    }
+    return probeIndex(*it->second, tBoard, key, tWDL, tDTZ, tState);
+}
+
+// Captures are "don't care" positions for the generator, as is any position where the best move
+// zeroes the fifty-move counter for DTZ, so they are searched before trusting the table
+template <bool tCheckZeroing>
+wdlScore Tablebases::search(Board &tBoard, int &tState)
+{
+    MoveList moves;
+    mGenerator.legal(tBoard, moves);
+    wdlScore bestValue = wdlLoss;
+    size_t moveCount = 0;
+
+    // A winning capture ends the search, trying them before pawn pushes spares probing the tables
+    // the pushes lead to, which may not be available
+    if (tCheckZeroing) std::stable_partition(moves.begin(), moves.end(), [](Move tMove) {return tMove.isCapture();});
+
+    for (Move move : moves) {
+        if (!move.isCapture() && (!tCheckZeroing || tBoard.searchPiece(move.from()) != pawn)) continue;
+        moveCount ++;
+
+        tBoard.makeMove(move);
+        const wdlScore value = wdlScore(-search<false>(tBoard, tState));
+        tBoard.undoMove(move);
+
+        if (tState == probeFail) return wdlDraw;
+        if (value > bestValue) {
+            bestValue = value;
+            if (value >= wdlWin) {
+                tState = probeZeroingBestMove;
+                return value;
+            }
+        }
+    }
+
+    // When every move was searched the table isn't needed, and could be wrong with en passant rights
+    const bool noMoreMoves = moveCount && moveCount == moves.size();
+    wdlScore value = bestValue;
+    if (!noMoreMoves) {
+        value = wdlScore(probeTable<false>(tBoard, tState));
+        if (tState == probeFail) return wdlDraw;
+    }
+
+    if (bestValue >= value) {
+        tState = bestValue > wdlDraw || noMoreMoves ? probeZeroingBestMove : probeOk;
+        return bestValue;
+    }
+    tState = probeOk;
+    return value;
+}
+
+int Tablebases::dtz(Board &tBoard, int &tState)
+{
+    const wdlScore wdl = search<true>(tBoard, tState);
+    if (tState == probeFail || wdl == wdlDraw) return 0;
+    if (tState == probeZeroingBestMove) return dtzBeforeZeroing(wdl);
+
+    int value = probeTable<true>(tBoard, tState, wdl);
+    if (tState == probeFail) return 0;
+    if (tState != probeChangeSTM)
+        return (value + 100 * (wdl == wdlBlessedLoss || wdl == wdlCursedWin)) * signOf(int(wdl));
+
+    // The table stores the other side to move: one ply search for the winning move with the lowest DTZ
+    int minDTZ = 0xffff;
+    MoveList moves;
+    mGenerator.legal(tBoard, moves);
+    for (Move move : moves) {
+        const bool zeroing = move.isCapture() || tBoard.searchPiece(move.from()) == pawn;
+
+        tBoard.makeMove(move);
+        tState = probeOk;
+        value = zeroing ? -dtzBeforeZeroing(search<false>(tBoard, tState)) : -dtz(tBoard, tState);
+        if (value == 1 && isMate(tBoard)) minDTZ = 1;
+        if (!zeroing) value += signOf(value);
+        if (value < minDTZ && signOf(value) == signOf(int(wdl))) minDTZ = value;
+        tBoard.undoMove(move);
+
+        if (tState == probeFail) return 0;
+    }
+    return minDTZ == 0xffff ? -1 : minDTZ;
+}
+
+wdlScore Tablebases::probeWDL(Board &tBoard, bool &tSuccess)
+{
+    int state = probeOk;
+    const wdlScore wdl = search<false>(tBoard, state);
+    tSuccess = state != probeFail;
+    return wdl;
+}
+
+int Tablebases::probeDTZ(Board &tBoard, bool &tSuccess)
+{
+    int state = probeOk;
+    const int value = dtz(tBoard, state);
+    tSuccess = state != probeFail;
+    return value;
+}
+
+bool Tablebases::isMate(Board &tBoard) const
+{
+    const int stm = tBoard.getSideToMove();
+    if (!mGenerator.isAttacked(tBoard, tBoard.getKingSquare(stm), 1 - stm)) return false;
+    MoveList moves;
+    mGenerator.legal(tBoard, moves);
+    return moves.empty();
+}
+
+bool Tablebases::filterRootMoves(Board &tBoard, bool tRepeated, MoveList &tMoves)
+{
+    const int hmc = tBoard.getHMC();
+    std::array<int, MoveList::CAPACITY> ranks;
+    int bestRank = INT_MIN;
+    bool success = true;
+
+    for (size_t i = 0; i < tMoves.size(); i ++) {
+        tBoard.makeMove(tMoves[i]);
+
+        // DTZ counted from the root, zeroing moves only have their WDL outcome
+        int dtz;
+        if (tBoard.getHMC() == 0) dtz = dtzBeforeZeroing(wdlScore(-probeWDL(tBoard, success)));
+        else {
+            dtz = -probeDTZ(tBoard, success);
+            dtz = dtz > 0 ? dtz + 1 : dtz < 0 ? dtz - 1 : dtz;
+        }
+        if (dtz == 2 && isMate(tBoard)) dtz = 1;
+
+        tBoard.undoMove(tMoves[i]);
+        if (!success) return false;
+
+        // Wins the fifty-move rule can't spoil rank first, then the quickest ones to convert
+        ranks[i] = dtz > 0 ? (dtz + hmc <= 99 && !tRepeated ? 1000 : 1000 - (dtz + hmc))
+                 : dtz < 0 ? (-dtz * 2 + hmc < 100 ? -1000 : -1000 + (-dtz + hmc))
+                 : 0;
+        bestRank = std::max(bestRank, ranks[i]);
+    }
+
+    MoveList best;
+    for (size_t i = 0; i < tMoves.size(); i ++) if (ranks[i] == bestRank) best.push(tMoves[i]);
+    tMoves = best;
+    return true;
+}
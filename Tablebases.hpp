@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Board.hpp"
+#include "Move.hpp"
+#include "MoveGenerator.hpp"
+#include "MoveList.hpp"
+#include "utils.hpp"
+
+// Win/draw/loss outcome of a tablebase position, from the side to move point of view.
+// Cursed wins and blessed losses are decided by the fifty-move rule
+enum wdlScore {
+    wdlLoss = -2, wdlBlessedLoss = -1, wdlDraw = 0, wdlCursedWin = 1, wdlWin = 2
+};
+
+struct TBTable;
+
+// Syzygy endgame tablebases. Files are found on init() but only memory mapped
+// the first time a position of their material is probed
+class Tablebases
+{
+public:
+    // Deleted methods for singleton pattern
+    Tablebases(const Tablebases&)             =delete;
+    Tablebases& operator=(const Tablebases&)  =delete;
+
+    static Tablebases& getInstance();
+
+    /**
+     * @brief Drops every table and looks for the .rtbw/.rtbz files in the given directories
+     *
+     * @param tPaths Directories separated by ':' (';' on Windows), "<empty>" or "" to disable probing
+     * @return int Number of WDL tables found
+     */
+    int init(const std::string &tPaths);
+
+    /**
+     * @brief Number of pieces, kings included, of the largest table found
+     */
+    inline int largest() const {return mLargest;}
+
+    /**
+     * @brief Tells if a position can be probed: few enough pieces and no castling rights
+     */
+    inline bool canProbe(const Board &tBoard) const {
+        return mLargest && !tBoard.getCastles()
+            && popCount(tBoard.getBitboard(white) | tBoard.getBitboard(black)) <= mLargest;
+    }
+
+    /**
+     * @brief Probes the WDL tables, looking at captures first since the tables don't store them reliably
+     *
+     * @param tBoard Position to probe, left unchanged
+     * @param tSuccess Set to false if a table is missing or unreadable
+     * @return wdlScore Outcome assuming the fifty-move counter is zero
+     */
+    wdlScore probeWDL(Board &tBoard, bool &tSuccess);
+
+    /**
+     * @brief Probes the DTZ tables
+     *
+     * @param tBoard Position to probe, left unchanged
+     * @param tSuccess Set to false if a table is missing or unreadable
+     * @return int Plies to the next capture or pawn move with best play, positive when winning,
+     * beyond +-100 for cursed wins and blessed losses, 0 for draws and -1 when mated
+     */
+    int probeDTZ(Board &tBoard, bool &tSuccess);
+
+    /**
+     * @brief Keeps only the root moves that preserve the best tablebase outcome, taking the fifty-move
+     * counter into account so that a won position is actually converted
+     *
+     * @param tBoard Root position
+     * @param tRepeated Whether the root already occurred since the last capture or pawn move
+     * @param tMoves Legal root moves, filtered in place
+     * @return true on success, tMoves is left untouched otherwise
+     */
+    bool filterRootMoves(Board &tBoard, bool tRepeated, MoveList &tMoves);
+
+private:
+    Tablebases();
+    ~Tablebases();
+
+    template <bool tCheckZeroing>
+    wdlScore search(Board &tBoard, int &tState);
+    int dtz(Board &tBoard, int &tState);
+
+    template <bool tDTZ>
+    int probeTable(const Board &tBoard, int &tState, wdlScore tWDL = wdlDraw);
+
+    bool isMate(Board &tBoard) const;
+    uint64_t materialKey(const Board &tBoard) const;
+    bool map(TBTable &tTable, bool tDTZ);
+
+private:
+    const MoveGenerator mGenerator;
+    std::vector<std::string> mPaths;
+    std::vector<std::unique_ptr<TBTable>> mTables;
+    std::unordered_map<uint64_t, TBTable*> mByMaterial;  // both colour assignments of every table
+    int mLargest = 0;
+};
@@ -0,0 +1,260 @@
+#include "TestSuite.hpp"
+#include "Board.hpp"
+#include "Move.hpp"
+#include "MoveGenerator.hpp"
+#include "MoveList.hpp"
+#include "TT.hpp"
+#include "Worker.hpp"
+#include "notation.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct TestPosition
+{
+    std::string id;
+    std::string fen;
+    std::vector<Move> bestMoves;    // bm, any of them solves the position
+    std::vector<Move> avoidMoves;   // am, none of them may be played
+};
+
+struct TestResult
+{
+    Move move;
+    bool solved = false;
+    TimePoint time = 0;     // time to solution, or total search time when unsolved
+    uint64_t nodes = 0;     // nodes to solution, or total nodes when unsolved
+    int depth = 0;
+};
+
+// Standard algebraic notation without check marks, which EPD files don't use consistently
+std::string toSan(const Board &tBoard, Move tMove, const MoveList &tLegal)
+{
+    static constexpr char pieceChars[8] = {0, 0, 'P', 'N', 'B', 'R', 'Q', 'K'};
+    static constexpr char files[] = "abcdefgh", ranks[] = "12345678";
+
+    if (tMove.isCastle()) return tMove.to() % 8 == 6 ? "O-O" : "O-O-O";
+
+    const int piece = tBoard.searchPiece(tMove.from());
+    std::string san;
+    if (piece == pawn) {
+        if (tMove.isCapture()) san += files[tMove.from() % 8];
+    }
+    else {
+        san += pieceChars[piece];
+        bool ambiguous = false, sameFile = false, sameRank = false;
+        for (Move other : tLegal) {
+            if (other.to() != tMove.to() || other.from() == tMove.from() || tBoard.searchPiece(other.from()) != piece) continue;
+            ambiguous = true;
+            sameFile |= other.from() % 8 == tMove.from() % 8;
+            sameRank |= other.from() / 8 == tMove.from() / 8;
+        }
+        if (ambiguous && (!sameFile || sameRank)) san += files[tMove.from() % 8];
+        if (ambiguous && sameFile) san += ranks[tMove.from() / 8];
+    }
+    if (tMove.isCapture()) san += 'x';
+    san += files[tMove.to() % 8];
+    san += ranks[tMove.to() / 8];
+    if (tMove.isPromo()) san += pieceChars[tMove.promoPiece()];
+    return san;
+}
+
+// Matches a move operand in SAN or coordinate notation against the legal moves
+Move parseMove(const Board &tBoard, std::string tToken, const MoveList &tLegal)
+{
+    std::string san;
+    for (char c : tToken)
+        if (!std::strchr("+#!?=", c)) san += c == '0' ? 'O' : c;
+
+    std::transform(tToken.begin(), tToken.end(), tToken.begin(), [](unsigned char c) {return std::tolower(c);});
+
+    for (Move move : tLegal)
+        if (toSan(tBoard, move, tLegal) == san || move.asString() == tToken) return move;
+    return Move();
+}
+
+// "<placement> <side> <castling> <en passant> <opcode> <operands>; ...", only bm, am and id are read
+bool parseLine(const std::string &tLine, int tLineNumber, const MoveGenerator &tGenerator, TestPosition &outPosition)
+{
+    std::istringstream fields(tLine);
+    std::string placement, side, castles, ep;
+    if (!(fields >> placement >> side >> castles >> ep)) return false;
+    outPosition.fen = placement + ' ' + side + ' ' + castles + ' ' + ep;
+    outPosition.id = "line " + std::to_string(tLineNumber);
+
+    const Board board(outPosition.fen);
+    if (popCount(board.getBitboard(white) & board.getBitboard(king)) != 1 ||
+        popCount(board.getBitboard(black) & board.getBitboard(king)) != 1) {
+        std::cout << "info string " << outPosition.id << ": invalid position" << std::endl;
+        return false;
+    }
+    MoveList legal;
+    tGenerator.legal(board, legal);
+
+    std::string operations((std::istreambuf_iterator<char>(fields)), std::istreambuf_iterator<char>());
+    std::istringstream opStream(operations);
+    std::string operation;
+    while (std::getline(opStream, operation, ';')) {
+        std::istringstream operands(operation);
+        std::string opcode, operand;
+        if (!(operands >> opcode)) continue;
+
+        if (opcode == "id") {
+            const size_t first = operation.find('"'), last = operation.rfind('"');
+            if (first != std::string::npos && last > first) outPosition.id = operation.substr(first + 1, last - first - 1);
+        }
+        else if (opcode == "bm" || opcode == "am") {
+            while (operands >> operand) {
+                const Move move = parseMove(board, operand, legal);
+                if (!move.isInit()) {
+                    std::cout << "info string line " << tLineNumber << ": illegal move " << operand << std::endl;
+                    return false;
+                }
+                (opcode == "bm" ? outPosition.bestMoves : outPosition.avoidMoves).push_back(move);
+            }
+        }
+    }
+    return !outPosition.bestMoves.empty() || !outPosition.avoidMoves.empty();
+}
+
+}
+
+void TestSuiteConfig::parse(std::istream &tIss)
+{
+    std::string name;
+    while (tIss >> name) {
+        if      (name == "file")     tIss >> file;
+        else if (name == "threads")  tIss >> threads;
+        else if (name == "movetime") tIss >> movetime;
+        else if (name == "nodes")    tIss >> nodes;
+        else if (name == "depth")    tIss >> depth;
+        else if (name == "hash")     tIss >> hash;
+        else {
+            std::string value;
+            tIss >> value;
+            std::cout << "info string unknown testsuite option " << name << std::endl;
+        }
+    }
+    threads = std::max(threads, 1);
+    hash = std::max(hash, 1);
+}
+
+int TestSuite::run()
+{
+    std::ifstream in(mConfig.file);
+    if (!in) {
+        std::cout << "info string could not open " << mConfig.file << std::endl;
+        return 0;
+    }
+
+    const MoveGenerator generator;
+    std::vector<TestPosition> positions;
+    std::string line;
+    for (int lineNumber = 1; std::getline(in, line); lineNumber ++) {
+        TestPosition position;
+        if (parseLine(line, lineNumber, generator, position)) positions.push_back(std::move(position));
+    }
+    if (positions.empty()) {
+        std::cout << "info string no position with a bm or am opcode in " << mConfig.file << std::endl;
+        return 0;
+    }
+
+    std::vector<TestResult> results(positions.size());
+    std::atomic<size_t> nextPosition = 0, finishedPositions = 0;
+    std::atomic<int> finishedThreads = 0;
+    const int threadCount = int(std::min(size_t(mConfig.threads), positions.size()));
+
+    auto solve = [&] {
+        TT tt(size_t(mConfig.hash));
+        const std::atomic<bool> goSearch = true;
+        std::vector<std::unique_ptr<Worker>> pool;
+        pool.emplace_back(std::make_unique<Worker>(0, tt, goSearch, pool));
+        Worker &worker = *pool[0];
+        worker.setSilent(true);
+
+        SearchLimits limits;
+        limits.movetime = mConfig.movetime;
+        limits.nodes = mConfig.nodes;
+        limits.depth = mConfig.depth;
+        const int maxDepth = mConfig.depth ? std::min(mConfig.depth, MAX_DEPTH) : MAX_DEPTH;
+
+        for (size_t i; (i = nextPosition.fetch_add(1)) < positions.size(); ) {
+            const TestPosition &position = positions[i];
+            const Board board(position.fen);
+
+            // Positions are unrelated, nothing learnt on one may help with the next
+            tt.clear();
+            worker.clearHistory();
+            worker.setPos(board, {board.getHash()});
+            limits.timestart = now();
+            worker.iterate(maxDepth, limits);
+
+            TestResult &result = results[i];
+            result.move = worker.getBestMove();
+            result.depth = worker.getCompletedDepth();
+            const auto contains = [&](const std::vector<Move> &tMoves) {return std::find(tMoves.begin(), tMoves.end(), result.move) != tMoves.end();};
+            result.solved = (position.bestMoves.empty() || contains(position.bestMoves)) && !contains(position.avoidMoves);
+            result.time  = result.solved ? worker.getBestMoveTime()  : now() - limits.timestart;
+            result.nodes = result.solved ? worker.getBestMoveNodes() : worker.getSearchedNodes();
+            finishedPositions ++;
+        }
+        finishedThreads ++;
+    };
+
+    const TimePoint start = now();
+    std::vector<std::thread> threads;
+    for (int id = 0; id < threadCount; id ++) threads.emplace_back(solve);
+
+    TimePoint lastReport = start;
+    while (finishedThreads < threadCount) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        if (now() - lastReport >= 10000) {
+            std::cout << "info string positions " << finishedPositions << "/" << positions.size() << std::endl;
+            lastReport = now();
+        }
+    }
+    for (auto &thread : threads) thread.join();
+
+    int solved = 0;
+    TimePoint solvedTime = 0;
+    uint64_t solvedNodes = 0;
+    for (size_t i = 0; i < positions.size(); i ++) {
+        const TestPosition &position = positions[i];
+        const TestResult &result = results[i];
+        MoveList legal;
+        const Board board(position.fen);
+        generator.legal(board, legal);
+
+        std::cout << "info string " << std::left << std::setw(16) << position.id << (result.solved ? " solved " : " failed ")
+                  << std::setw(7) << (result.move.isInit() ? toSan(board, result.move, legal) : "none") << std::right
+                  << " time " << std::setw(6) << result.time << " nodes " << std::setw(10) << result.nodes
+                  << " depth " << std::setw(2) << result.depth;
+        if (!result.solved) {
+            if (!position.bestMoves.empty()) std::cout << " bm";
+            for (Move move : position.bestMoves)  std::cout << ' ' << toSan(board, move, legal);
+            if (!position.avoidMoves.empty()) std::cout << " am";
+            for (Move move : position.avoidMoves) std::cout << ' ' << toSan(board, move, legal);
+        }
+        std::cout << std::endl;
+
+        if (result.solved) {
+            solved ++;
+            solvedTime += result.time;
+            solvedNodes += result.nodes;
+        }
+    }
+
+    std::cout << "info string solved " << solved << "/" << positions.size() << " time to solve " << solvedTime
+              << " nodes to solve " << solvedNodes << " wall time " << now() - start << std::endl;
+    return solved;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <string>
+
+#include "utils.hpp"
+
+// Test suite settings, every field can be given as "<name> <value>" on the command line.
+// Every limit that is set applies, the search stops at the first one reached
+struct TestSuiteConfig
+{
+    std::string file;           // EPD file, positions need a bm or am opcode
+    int threads = 1;            // positions searched concurrently, each with its own search and hash table
+    TimePoint movetime = 1000;  // time limit of every search in ms, 0 for none
+    uint64_t nodes = 0;         // node limit of every search, 0 for none
+    int depth = 0;              // depth limit of every search, 0 for none
+    int hash = 16;              // hash table size of every thread in MB
+
+    /**
+     * @brief Reads "<name> <value>" pairs until the end of the stream, unknown pairs are reported and skipped
+     */
+    void parse(std::istream &tIss);
+};
+
+// Runs a tactical suite (WAC, STS, ECM...) and reports, for every position, whether the search
+// ended on a bm move and off the am moves, with the time and nodes since which it kept that move
+class TestSuite
+{
+public:
+    explicit TestSuite(const TestSuiteConfig &tConfig) : mConfig{tConfig} {}
+
+    /**
+     * @brief Searches every position of the file and prints one line per position and a summary
+     *
+     * @return int Number of positions solved
+     */
+    int run();
+
+private:
+    TestSuiteConfig mConfig;
+};
@@ -0,0 +1,60 @@
+#include "TimeManager.hpp"
+#include <algorithm>
+
+void TimeManager::init(const SearchLimits &tLimits, int tSide)
+{
+    // Time lost to the GUI and to process scheduling between moves
+    static constexpr TimePoint moveOverhead = 30;
+    static constexpr int defaultMovesToGo = 30;
+    // Floor of both budgets, so that a nearly flagged clock still leaves time for a couple of iterations
+    static constexpr TimePoint minBudget = 5;
+
+    mStart = tLimits.timestart;
+    mInstability = 0.0;
+    mFailLow = false;
+
+    if (tLimits.infinite) {
+        mMode = untimed;
+    }
+    else if (tLimits.movetime) {
+        mMode = fixedTime;
+        mSoft = mHard = tLimits.movetime;
+    }
+    else if (tLimits.time[tSide]) {
+        mMode = clockTime;
+        const TimePoint available = std::max(TimePoint(1), tLimits.time[tSide] - moveOverhead);
+        const int movesToGo = tLimits.movestogo ? std::min(tLimits.movestogo, 50) : defaultMovesToGo;
+
+        // Soft budget is the fair share of the remaining clock, the hard one lets
+        // an unstable search overrun it but never spends more than a fifth of the clock
+        mSoft = available / movesToGo + tLimits.inc[tSide] * 3 / 4;
+        mHard = std::min(available / 5 + tLimits.inc[tSide] * 3 / 4, mSoft * 5);
+        if (movesToGo == 1) mHard = available;
+        mHard = std::min(mHard, available);
+        mSoft = std::min(mSoft, mHard);
+        mHard = std::max(mHard, minBudget);
+        mSoft = std::max(mSoft, minBudget);
+    }
+    else {
+        mMode = untimed;
+    }
+}
+
+bool TimeManager::stopIterating(TimePoint tIterationTime) const
+{
+    if (mMode == untimed) return false;
+    if (mMode == fixedTime) return elapsed() >= mHard;
+
+    // Unstable best moves and fail-lows can stretch the soft budget up to the hard one
+    const double scale = (1.0 + mInstability) * (mFailLow ? 1.5 : 1.0);
+    const TimePoint budget = std::min(mHard, TimePoint(mSoft * scale));
+
+    // The next iteration usually takes at least twice as long as the last one
+    return elapsed() + 2 * tIterationTime >= budget;
+}
+
+void TimeManager::onIteration(bool tBestMoveChanged, bool tFailedLow)
+{
+    mInstability = mInstability / 2 + (tBestMoveChanged ? 1.0 : 0.0);
+    mFailLow = tFailedLow;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "utils.hpp"
+
+class TimeManager
+{
+public:
+    /**
+     * @brief Computes the time budgets for the upcoming search
+     *
+     * @param tLimits Search parameters as per SearchLimits specification
+     * @param tSide Color of the side to move, selects the clock to read
+     */
+    void init(const SearchLimits &tLimits, int tSide);
+
+    /**
+     * @brief Checks the hard budget, past which the search must be aborted mid-iteration
+     *
+     * @return true if the search must stop immediately
+     */
+    inline bool hardLimitReached() const {return mMode != untimed && elapsed() >= mHard;}
+
+    /**
+     * @brief Decides whether another iteration can finish within the soft budget
+     *
+     * @param tIterationTime Duration of the iteration just completed
+     * @return true if the next iteration shouldn't be started
+     */
+    bool stopIterating(TimePoint tIterationTime) const;
+
+    /**
+     * @brief Stretches the soft budget when the root is unstable
+     *
+     * @param tBestMoveChanged The last iteration picked a different best move
+     * @param tFailedLow The last iteration failed low at the root at least once
+     */
+    void onIteration(bool tBestMoveChanged, bool tFailedLow);
+
+    inline TimePoint elapsed() const {return now() - mStart;}
+
+private:
+    enum timeMode {untimed, fixedTime, clockTime};
+
+    timeMode mMode = untimed;
+    TimePoint mStart = 0;
+    TimePoint mSoft = 0, mHard = 0;
+    double mInstability = 0.0;
+    bool mFailLow = false;
+};
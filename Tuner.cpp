@@ -0,0 +1,293 @@
+#include "Tuner.hpp"
+#include "Datagen.hpp"
+#include "notation.hpp"
+#include "utils.hpp"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <thread>
+
+namespace {
+
+constexpr const char *PIECE_NAMES[6] = {"Pawn", "Knight", "Bishop", "Rook", "Queen", "King"};
+
+// Expected score of white for an evaluation in centipawns
+inline double sigmoid(double tEval, double tK) {return 1.0 / (1.0 + std::exp(-tK * tEval * std::log(10.0) / 400.0));}
+
+}
+
+void TunerConfig::parse(std::istream &tIss)
+{
+    std::string name;
+    while (tIss >> name) {
+        if      (name == "data")    tIss >> data;
+        else if (name == "out")     tIss >> out;
+        else if (name == "threads") tIss >> threads;
+        else if (name == "epochs")  tIss >> epochs;
+        else if (name == "rate")    tIss >> rate;
+        else if (name == "lambda")  tIss >> lambda;
+        else if (name == "k")       tIss >> k;
+        else if (name == "limit")   tIss >> limit;
+        else {
+            std::string value;
+            tIss >> value;
+            std::cout << "info string unknown tune option " << name << std::endl;
+        }
+    }
+    threads = std::max(threads, 1);
+    lambda = std::clamp(lambda, 0.0, 1.0);
+}
+
+Tuner::Tuner(const TunerConfig &tConfig) : mConfig{tConfig}
+{
+    // Starts from the current tables
+    for (int piece = pawn; piece <= king; piece ++)
+        for (int square = 0; square < 64; square ++) {
+            mWeights[(piece - pawn) * 64 + square] = mgValue(piece, square);
+            mWeights[PST_WEIGHTS + (piece - pawn) * 64 + square] = egValue(piece, square);
+        }
+    mOffsets.push_back(0);
+}
+
+void Tuner::addPosition(const int tSquarePieces[64], int tMaterial, float tResult, float tScore)
+{
+    for (int square = a1; square <= h8; square ++) {
+        if (!tSquarePieces[square]) continue;
+        const int color = tSquarePieces[square] >> 3, piece = tSquarePieces[square] & 7;
+        mIndices.push_back(uint16_t(pstWeightIndex(color, piece, square)));
+        mSigns.push_back(color == white ? 1 : -1);
+    }
+    mOffsets.push_back(uint32_t(mIndices.size()));
+    mPhases.push_back(gamePhase(tMaterial) / 100.0f);
+    mResults.push_back(tResult);
+    mScores.push_back(tScore);
+}
+
+bool Tuner::loadPacked()
+{
+    std::ifstream in(mConfig.data, std::ios::binary);
+    if (!in) return false;
+
+    std::vector<PackedPosition> chunk(1 << 16);
+    while (in) {
+        in.read(reinterpret_cast<char*>(chunk.data()), std::streamsize(chunk.size() * sizeof(PackedPosition)));
+        const size_t count = size_t(in.gcount()) / sizeof(PackedPosition);
+        for (size_t i = 0; i < count; i ++) {
+            if (mConfig.limit && mResults.size() >= mConfig.limit) return true;
+            const PackedPosition &packed = chunk[i];
+
+            int squarePieces[64] = {}, material = 0, index = 0;
+            for (uint64_t b = packed.occupancy; b; b &= b - 1, index ++) {
+                const int code = (packed.pieces[index / 2] >> (index % 2 ? 4 : 0)) & 0xf;
+                squarePieces[bitScanForward(b)] = (code >> 3) * 8 + (code & 7) + pawn;
+                material += phaseValue[(code & 7) + pawn];
+            }
+            addPosition(squarePieces, material, packed.result / 2.0f, packed.score);
+        }
+    }
+    return true;
+}
+
+// Lines start with a FEN, the result can be anywhere after it: 1-0, 0-1, 1/2-1/2 or [1.0], [0.5], [0.0]
+bool Tuner::loadEPD()
+{
+    std::ifstream in(mConfig.data);
+    if (!in) return false;
+
+    std::string line;
+    while (std::getline(in, line)) {
+        if (mConfig.limit && mResults.size() >= mConfig.limit) break;
+
+        float result;
+        if      (line.find("1/2-1/2") != std::string::npos || line.find("[0.5]") != std::string::npos) result = 0.5f;
+        else if (line.find("1-0") != std::string::npos || line.find("[1.0]") != std::string::npos) result = 1.0f;
+        else if (line.find("0-1") != std::string::npos || line.find("[0.0]") != std::string::npos) result = 0.0f;
+        else continue;
+
+        std::istringstream fields(line);
+        std::string placement;
+        fields >> placement;
+
+        static const std::string pieceChars = "PNBRQK";
+        int squarePieces[64] = {}, material = 0, square = 56;
+        bool valid = true;
+        for (char c : placement) {
+            if (c == '/') square -= 16;
+            else if (c >= '1' && c <= '8') square += c - '0';
+            else {
+                const size_t piece = pieceChars.find(char(std::toupper(c)));
+                if (piece == std::string::npos || square < 0 || square > 63) {
+                    valid = false;
+                    break;
+                }
+                squarePieces[square ++] = (std::islower(c) ? black : white) * 8 + int(piece) + pawn;
+                material += phaseValue[piece + pawn];
+            }
+        }
+        if (valid) addPosition(squarePieces, material, result, std::numeric_limits<float>::quiet_NaN());
+    }
+    return true;
+}
+
+bool Tuner::load()
+{
+    const bool packed = mConfig.data.size() > 4 && mConfig.data.compare(mConfig.data.size() - 4, 4, ".bin") == 0;
+    if (!(packed ? loadPacked() : loadEPD()) || mResults.empty()) return false;
+    std::cout << "info string loaded " << mResults.size() << " positions, " << mIndices.size() << " features" << std::endl;
+    return true;
+}
+
+// Splits the positions into one contiguous range per thread
+template <typename F>
+void Tuner::parallelRanges(F tFunction) const
+{
+    const size_t count = mResults.size();
+    const size_t threads = std::min(size_t(mConfig.threads), count);
+    std::vector<std::thread> pool;
+    for (size_t t = 0; t < threads; t ++)
+        pool.emplace_back(tFunction, t, count * t / threads, count * (t + 1) / threads);
+    for (auto &thread : pool) thread.join();
+}
+
+double Tuner::error(double tK) const
+{
+    std::vector<double> sums(mConfig.threads, 0.0);
+    parallelRanges([&](size_t tThread, size_t tBegin, size_t tEnd) {
+        double sum = 0.0;
+        for (size_t p = tBegin; p < tEnd; p ++) {
+            double mg = 0.0, eg = 0.0;
+            for (uint32_t i = mOffsets[p]; i < mOffsets[p + 1]; i ++) {
+                mg += mSigns[i] * mWeights[mIndices[i]];
+                eg += mSigns[i] * mWeights[PST_WEIGHTS + mIndices[i]];
+            }
+            const double diff = mTargets[p] - sigmoid(mg * mPhases[p] + eg * (1.0 - mPhases[p]), tK);
+            sum += diff * diff;
+        }
+        sums[tThread] = sum;
+    });
+
+    double total = 0.0;
+    for (double sum : sums) total += sum;
+    return total / mResults.size();
+}
+
+// Scale that best maps the current evaluation to the results, found by narrowing scans
+double Tuner::fitK() const
+{
+    double best = 1.0, step = 0.5;
+    double bestError = error(best);
+    for (int round = 0; round < 6; round ++, step /= 5) {
+        const double center = best;
+        for (double k = std::max(0.05, center - 5 * step); k <= center + 5 * step; k += step) {
+            const double e = error(k);
+            if (e < bestError) {
+                bestError = e;
+                best = k;
+            }
+        }
+    }
+    return best;
+}
+
+void Tuner::gradient(std::array<double, WEIGHTS> &outGradient) const
+{
+    std::vector<std::array<double, WEIGHTS>> partials(mConfig.threads);
+    parallelRanges([&](size_t tThread, size_t tBegin, size_t tEnd) {
+        std::array<double, WEIGHTS> &partial = partials[tThread];
+        partial.fill(0.0);
+        for (size_t p = tBegin; p < tEnd; p ++) {
+            double mg = 0.0, eg = 0.0;
+            for (uint32_t i = mOffsets[p]; i < mOffsets[p + 1]; i ++) {
+                mg += mSigns[i] * mWeights[mIndices[i]];
+                eg += mSigns[i] * mWeights[PST_WEIGHTS + mIndices[i]];
+            }
+            const double phase = mPhases[p];
+            const double s = sigmoid(mg * phase + eg * (1.0 - phase), mK);
+            // d(target - s)^2 / d eval, the constant factors are left to the step size of Adam
+            const double delta = (s - mTargets[p]) * s * (1.0 - s);
+            for (uint32_t i = mOffsets[p]; i < mOffsets[p + 1]; i ++) {
+                partial[mIndices[i]] += mSigns[i] * delta * phase;
+                partial[PST_WEIGHTS + mIndices[i]] += mSigns[i] * delta * (1.0 - phase);
+            }
+        }
+    });
+
+    outGradient.fill(0.0);
+    for (const auto &partial : partials)
+        for (int w = 0; w < WEIGHTS; w ++) outGradient[w] += partial[w];
+}
+
+bool Tuner::run()
+{
+    if (!load()) {
+        std::cout << "info string could not load tuning data from " << mConfig.data << std::endl;
+        return false;
+    }
+
+    // K is fitted on the results alone, scores then get blended in through the same sigmoid
+    mTargets = mResults;
+    mK = mConfig.k > 0 ? mConfig.k : fitK();
+    for (size_t p = 0; p < mResults.size(); p ++)
+        if (!std::isnan(mScores[p])) mTargets[p] = float(mConfig.lambda * mResults[p] + (1.0 - mConfig.lambda) * sigmoid(mScores[p], mK));
+    std::cout << "info string K " << mK << " error " << error(mK) << std::endl;
+
+    static constexpr double beta1 = 0.9, beta2 = 0.999, epsilon = 1e-8;
+    std::array<double, WEIGHTS> grad, momentum {}, velocity {};
+    const TimePoint start = now();
+
+    for (int epoch = 1; epoch <= mConfig.epochs; epoch ++) {
+        gradient(grad);
+        const double correction1 = 1.0 - std::pow(beta1, epoch), correction2 = 1.0 - std::pow(beta2, epoch);
+        for (int w = 0; w < WEIGHTS; w ++) {
+            momentum[w] = beta1 * momentum[w] + (1.0 - beta1) * grad[w];
+            velocity[w] = beta2 * velocity[w] + (1.0 - beta2) * grad[w] * grad[w];
+            mWeights[w] -= mConfig.rate * (momentum[w] / correction1) / (std::sqrt(velocity[w] / correction2) + epsilon);
+        }
+        if (epoch % 50 == 0 || epoch == mConfig.epochs)
+            std::cout << "info string epoch " << epoch << " error " << error(mK) << " time " << now() - start << std::endl;
+    }
+
+    if (!write()) {
+        std::cout << "info string could not write " << mConfig.out << std::endl;
+        return false;
+    }
+    std::cout << "info string tables written to " << mConfig.out << std::endl;
+    return true;
+}
+
+// Same layout as pst.hpp: piece values are the mean weight over the squares a piece can stand on,
+// the tables hold what is left. Kings keep a value of 0
+bool Tuner::write() const
+{
+    std::ofstream out(mConfig.out);
+    if (!out) return false;
+
+    for (int phase = 0; phase < 2; phase ++) {
+        const char *prefix = phase ? "eg" : "mg";
+        int values[6];
+        for (int piece = 0; piece < 6; piece ++) {
+            const double *weights = &mWeights[phase * PST_WEIGHTS + piece * 64];
+            const int first = piece == 0 ? 8 : 0, last = piece == 0 ? 56 : 64;
+            double sum = 0.0;
+            for (int square = first; square < last; square ++) sum += weights[square];
+            values[piece] = piece == 5 ? 0 : int(std::lround(sum / (last - first)));
+
+            out << "inline constexpr int16_t " << prefix << PIECE_NAMES[piece] << "Table[64] = {\n";
+            for (int square = 0; square < 64; square ++) {
+                const bool unused = piece == 0 && (square < first || square >= last);
+                const long entry = unused ? 0 : std::lround(weights[square]) - values[piece];
+                out << (square % 8 ? "" : "    ") << std::setw(4) << entry << (square == 63 ? "" : ",") << (square % 8 == 7 ? "\n" : " ");
+            }
+            out << "};\n\n";
+        }
+
+        out << "inline constexpr int16_t " << prefix << "PieceValue[6] = {";
+        for (int piece = 0; piece < 6; piece ++) out << ' ' << values[piece] << (piece == 5 ? "" : ",");
+        out << "};\n\n";
+    }
+    return bool(out);
+}
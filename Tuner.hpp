@@ -0,0 +1,74 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <vector>
+
+#include "pst.hpp"
+
+// Tuning settings, every field can be given as "<name> <value>" on the command line
+struct TunerConfig
+{
+    std::string data;           // PackedPosition records (.bin) or EPD lines carrying the game result
+    std::string out = "pst_tuned.hpp";
+    int threads = 1;
+    int epochs = 500;
+    double rate = 1.0;          // Adam step size, in centipawns
+    double lambda = 1.0;        // target is lambda * result + (1 - lambda) * sigmoid(score), scores only come with .bin data
+    double k = 0.0;             // sigmoid scale, 0 fits it to the data before tuning
+    uint64_t limit = 0;         // positions to load at most, 0 for all of them
+
+    /**
+     * @brief Reads "<name> <value>" pairs until the end of the stream, unknown pairs are reported and skipped
+     */
+    void parse(std::istream &tIss);
+};
+
+// Texel tuning of the PST evaluation: the mg and eg weights (see pstWeightIndex) are fitted so that
+// sigmoid(eval) predicts the game results, by minimising the mean squared error with Adam.
+// Positions are kept as sparse feature lists packed one after the other, so that an epoch streams
+// through a few flat arrays that threads split into contiguous ranges
+class Tuner
+{
+public:
+    explicit Tuner(const TunerConfig &tConfig);
+
+    /**
+     * @brief Loads the data, tunes and writes the regenerated tables
+     *
+     * @return true if the data could be loaded and the tables written
+     */
+    bool run();
+
+private:
+    static constexpr int WEIGHTS = 2 * PST_WEIGHTS;     // mg weights, then eg weights
+
+    bool load();
+    bool loadPacked();
+    bool loadEPD();
+    void addPosition(const int tSquarePieces[64], int tMaterial, float tResult, float tScore);
+
+    template <typename F>
+    void parallelRanges(F tFunction) const;
+
+    double error(double tK) const;
+    double fitK() const;
+    void gradient(std::array<double, WEIGHTS> &outGradient) const;
+    bool write() const;
+
+private:
+    TunerConfig mConfig;
+    std::array<double, WEIGHTS> mWeights;
+
+    // Feature i of position p sits at mOffsets[p] <= i < mOffsets[p + 1]
+    std::vector<uint32_t> mOffsets;
+    std::vector<uint16_t> mIndices;     // mg weight index, the eg one is PST_WEIGHTS further
+    std::vector<int8_t> mSigns;         // +1 for white pieces, -1 for black ones
+    std::vector<float> mPhases;         // weight of the mg terms, 0..1
+    std::vector<float> mResults;        // 0 loss, 0.5 draw, 1 win, for white
+    std::vector<float> mScores;         // search scores for white, NaN when unknown
+    std::vector<float> mTargets;
+    double mK = 1.0;
+};
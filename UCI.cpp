@@ -1,9 +1,37 @@
 #include "UCI.hpp"
+#include "Datagen.hpp"
+#include "TestSuite.hpp"
+#include "Tuner.hpp"
+#include "bench.hpp"
 #include "notation.hpp"
 #include "utils.hpp"
+#include <algorithm>
+#include <array>
 #include <iostream>
 #include <string>
 
+// Selective search parameters exposed as spin options
+struct Tunable {
+    const char *name;
+    int SearchParams::*field;
+    int min, max;
+};
+static constexpr std::array<Tunable, 13> tunables = {{
+    {"NullMoveDepth",   &SearchParams::nmpMinDepth,    0, 20},
+    {"NullMoveBase",    &SearchParams::nmpBase,        0, 10},
+    {"NullMoveDivisor", &SearchParams::nmpDivisor,     1, 20},
+    {"LMRDepth",        &SearchParams::lmrMinDepth,    0, 20},
+    {"LMRMoves",        &SearchParams::lmrMinMoves,    1, 64},
+    {"LMRBase",         &SearchParams::lmrBase,        0, 300},
+    {"LMRDivisor",      &SearchParams::lmrDivisor,     50, 1000},
+    {"RFPDepth",        &SearchParams::rfpDepth,       0, 20},
+    {"RFPMargin",       &SearchParams::rfpMargin,      0, 500},
+    {"RazorDepth",      &SearchParams::razorDepth,     0, 10},
+    {"RazorMargin",     &SearchParams::razorMargin,    0, 1000},
+    {"FutilityDepth",   &SearchParams::futilityDepth,  0, 20},
+    {"FutilityMargin",  &SearchParams::futilityMargin, 0, 500},
+}};
+
 void UCI::loop()
 {
     std::string cmd, token;
@@ -15,23 +43,65 @@ void UCI::loop()
         iss >> std::skipws >> token;
 
         if (token == "uci") {
-            std::string uciInfo = "id name Bagatto\nid author Claudio Raciti\noption name Hash type spin default 1 min 1 max 128\nuciok";
-            std::cout << uciInfo << std::endl;
+            std::string uciInfo = "id name Bagatto\nid author Claudio Raciti\noption name Hash type spin default 1 min 1 max 131072\noption name Threads type spin default 1 min 1 max 256\noption name EvalFile type string default <empty>\noption name UseNNUE type check default false\noption name CopyMake type check default false\noption name SyzygyPath type string default <empty>\noption name OwnBook type check default false\noption name BookFile type string default <empty>\noption name BookBestMove type check default false\n";
+            std::cout << uciInfo;
+            for (const Tunable &tunable : tunables)
+                std::cout << "option name " << tunable.name << " type spin default " << SearchParams().*tunable.field
+                          << " min " << tunable.min << " max " << tunable.max << "\n";
+            std::cout << "uciok" << std::endl;
         }
         else if (token == "isready") {
             std::cout << "readyok" << std::endl;
         }
         else if (token == "ucinewgame"){
-            mEngine.setPos(STARTPOS);
+            mEngine.newGame();
         }
-        else if (token == "setoptions"){
+        else if (token == "setoption"){
             std::string idName, name, idValue, value;
             iss >> idName >> name >> idValue >> value;
-            int memory = stoi(value);
-            if (idName == "name" && name == "Hash" && idValue == "value") {
-                if (memory >= 1 && memory <= 128) mEngine.resizeTT(memory);
+            if (idName != "name" || idValue != "value") continue;
+            if (name == "Hash") {
+                size_t memory = stoull(value);
+                if (memory >= 1 && memory <= 131072) mEngine.resizeTT(memory);
+                else std::cout << "value out of bounds" << std::endl;
+            }
+            else if (name == "Threads") {
+                int threads = stoi(value);
+                if (threads >= 1 && threads <= 256) mEngine.setThreads(threads);
+                else std::cout << "value out of bounds" << std::endl;
+            }
+            else if (name == "EvalFile") {
+                if (!mEngine.loadNetwork(value)) std::cout << "info string could not load network " << value << std::endl;
+            }
+            else if (name == "SyzygyPath") {
+                std::cout << "info string found " << mEngine.setSyzygyPath(value) << " tablebases" << std::endl;
+            }
+            else if (name == "BookFile") {
+                if (!mEngine.loadBook(value) && value != "<empty>") std::cout << "info string could not load book " << value << std::endl;
+            }
+            else if (name == "OwnBook") {
+                mEngine.setOwnBook(value == "true");
+            }
+            else if (name == "BookBestMove") {
+                mEngine.setBookBestMove(value == "true");
+            }
+            else if (name == "CopyMake") {
+                mEngine.setCopyMake(value == "true");
+            }
+            else if (auto tunable = std::find_if(tunables.begin(), tunables.end(), [&](const Tunable &t) {return name == t.name;});
+                     tunable != tunables.end()) {
+                const int param = stoi(value);
+                if (param >= tunable->min && param <= tunable->max) {
+                    SearchParams params = mEngine.getSearchParams();
+                    params.*tunable->field = param;
+                    mEngine.setSearchParams(params);
+                }
                 else std::cout << "value out of bounds" << std::endl;
             }
+            else if (name == "UseNNUE") {
+                if (mEngine.useNNUE(value == "true") != (value == "true"))
+                    std::cout << "info string no network loaded, set EvalFile first" << std::endl;
+            }
         }
         else if (token == "position") {
             std::string fen;
@@ -57,6 +127,33 @@ void UCI::loop()
         else if (token == "go") {
             go(iss);
         }
+        else if (token == "divide") {
+            int depth = 0;
+            if (iss >> depth) mEngine.perft(depth, true);
+        }
+        else if (token == "bench") {
+            int depth = BENCH_DEPTH, threads = 1;
+            iss >> depth >> threads;
+            mEngine.bench(depth, threads);
+        }
+        else if (token == "datagen") {
+            mEngine.stopSearch();
+            DatagenConfig config;
+            config.parse(iss);
+            Datagen(config).run();
+        }
+        else if (token == "tune") {
+            mEngine.stopSearch();
+            TunerConfig config;
+            config.parse(iss);
+            Tuner(config).run();
+        }
+        else if (token == "testsuite") {
+            mEngine.stopSearch();
+            TestSuiteConfig config;
+            config.parse(iss);
+            TestSuite(config).run();
+        }
         else if (token == "stop" || token == "quit"){
             mEngine.stopSearch();
         }
@@ -71,7 +168,12 @@ void UCI::go(std::istringstream& tIss)
 
 
     while(tIss >> token){
-        if (token == "infinite")
+        if (token == "perft") {
+            int depth = 0;
+            if (tIss >> depth) mEngine.perft(depth, false);
+            return;
+        }
+        else if (token == "infinite")
             limits.infinite = true; 
         else if (token == "wtime")
             tIss >> limits.time[white];
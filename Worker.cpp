@@ -0,0 +1,443 @@
+#include "Worker.hpp"
+#include "Board.hpp"
+#include "Move.hpp"
+#include "MoveGenerator.hpp"
+#include "MovePicker.hpp"
+#include "Tablebases.hpp"
+#include "TT.hpp"
+#include "evaluation.hpp"
+#include "notation.hpp"
+#include "utils.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// Scores beyond this are mates, pruning margins must not be applied to them
+static constexpr int16_t MATE_BOUND = -CHECKMATE - 2 * MAX_PLY;
+// Tablebase wins score just below the mates, minus the ply so that the closest one is preferred
+static constexpr int16_t TB_WIN = MATE_BOUND - MAX_PLY - 1;
+
+void Worker::setPos(const Board &tBoard, const std::vector<uint64_t> &tGameHist, const MoveList &tRootMoves)
+{
+    mBoard = tBoard;
+    mGameHist = tGameHist;
+    mRootMoves = tRootMoves;
+    mProbeTB = tRootMoves.empty();
+    // keeps pushes during the search from ever reallocating
+    mGameHist.reserve(tGameHist.size() + MAX_PLY);
+}
+
+void Worker::setParams(const SearchParams &tParams)
+{
+    mParams = tParams;
+    for (int depth = 1; depth < 64; depth ++)
+        for (int moves = 1; moves < 64; moves ++) {
+            const double reduction = (mParams.lmrBase + std::log(depth) * std::log(moves) * 100.0 / std::max(mParams.lmrDivisor, 1)) / 100.0;
+            mReductions[depth][moves] = uint8_t(std::clamp(reduction, 0.0, 63.0));
+        }
+}
+
+void Worker::iterate(int tMaxDepth, SearchLimits tLimits)
+{
+    static constexpr int16_t windowSize = 50;
+    int16_t eval = 0, alpha = CHECKMATE, beta = -CHECKMATE;
+
+    mLimits = tLimits;
+    mStopped = false;
+    mSearchedNodes = 0;
+    mTBHits = 0;
+    mCompletedDepth = -1;
+    mScore = 0;
+    mBestMoveTime = 0;
+    mBestMoveNodes = 0;
+    mKillers.assign(tMaxDepth + 1, {});
+    mHistory.age();
+    if (mId == 0) mTime.init(mLimits, mBoard.getSideToMove());
+
+    // Something legal to play even if no iteration ever writes a PV
+    MoveList rootMoves;
+    if (mRootMoves.empty()) mGenerator.legal(mBoard, rootMoves);
+    mBestMove = !mRootMoves.empty() ? mRootMoves[0] : !rootMoves.empty() ? rootMoves[0] : Move();
+
+    for(int depth = 0; depth <= tMaxDepth && !exitSearch(); depth ++){
+        int lowFails = 0, highFails = 0;
+        bool completed = false;
+        const TimePoint iterationStart = now();
+        const Move previousBest = mBestMove;
+        const bool firstResult = mCompletedDepth < 0;
+        mIterationDepth = depth;
+
+        do {
+            // exponentially widening the aspiration window for each failed search
+            if (eval <= alpha) alpha -= windowSize * (1 << ++lowFails);
+            if (eval >= beta ) beta  += windowSize * (1 << ++highFails);
+
+            eval = alphaBeta(depth, 0, alpha, beta);
+            // Read before exitSearch is called again, a limit reached right after the search doesn't void it
+            completed = !mStopped;
+
+            if (mId == 0 && !mSilent && completed) printSearchInfo(depth, now() - mLimits.timestart, eval);
+        } while ((eval <= alpha || eval >= beta) && !exitSearch());
+
+        if(mPVLength[0] && completed && eval > alpha && eval < beta) {
+            mBestMove = mPV[0][0];
+            mScore = eval;
+            mCompletedDepth = depth;
+            if (firstResult || mBestMove != previousBest) {
+                mBestMoveTime = now() - mLimits.timestart;
+                mBestMoveNodes = poolNodes();
+            }
+        }
+
+        // Only the main thread decides when to stop, helpers are halted by the engine. Depth 0 has no PV, never stop on it
+        if (mId == 0 && depth > 0 && !exitSearch()) {
+            mTime.onIteration(mBestMove != previousBest && !firstResult, lowFails > 0);
+            if (mTime.stopIterating(now() - iterationStart)) break;
+        }
+
+        alpha = eval - windowSize;
+        beta  = eval + windowSize;
+    }
+}
+
+uint64_t Worker::poolNodes() const
+{
+    uint64_t nodes = 0;
+    for (const auto &worker : mPool) nodes += worker->getSearchedNodes();
+    return nodes;
+}
+
+uint64_t Worker::poolTBHits() const
+{
+    uint64_t hits = 0;
+    for (const auto &worker : mPool) hits += worker->getTBHits();
+    return hits;
+}
+
+void Worker::printSearchInfo(int tDepth, int64_t tElapsed, int16_t tEval)
+{
+    const uint64_t nodes = poolNodes();
+    double elapsedSec = tElapsed / 1000.0;
+    uint64_t nps = (elapsedSec > 0) ? static_cast<uint64_t>(nodes / elapsedSec) : 0;
+
+    std::cout << "info depth " << tDepth << " nodes " << nodes << " time " << tElapsed << " nps " << nps
+              << " tbhits " << poolTBHits();
+
+    // if(eval <= CHECKMATE) std::cout << " mate " << (t_maxDepth - (CHECKMATE - eval)) / 2 + 1 << " ";
+    // else if( eval  >= -CHECKMATE) std::cout << " mate -" << (t_maxDepth - (CHECKMATE + eval)) / 2 + 1 << " ";
+    // else
+    std::cout << " score cp " << tEval;
+
+    if (mPVLength[0]){
+        std::cout << " pv ";
+        for (int ply = 0; ply < mPVLength[0] && mPV[0][ply].isInit(); ply ++) std::cout << mPV[0][ply] << " ";
+    }
+
+    std::cout << std::endl;
+}
+
+
+int16_t Worker::alphaBeta(int tDepth, int tPly, int16_t tAlpha, int16_t tBeta){
+    mPVLength[tPly] = 0;
+    if (exitSearch() || threefoldRepetition() || fiftyMove()) return DRAW;
+    if (tDepth <= 0) return quiescence(tPly, tAlpha, tBeta);
+
+    // Hash move search. The root cutoff hands its move to iterate as the best move, and a key
+    // fragment match may belong to another position, so there the move has to be legal here
+    uint64_t hashKey = mBoard.getHash();
+    auto [ttHit, ttEntry] = mTT.probe(hashKey);
+    const bool usableAtRoot = tPly || (mRootMoves.empty() && ttEntry.hashMove.isInit()
+        && mGenerator.validate(mBoard, ttEntry.hashMove) && mGenerator.isLegal(mBoard, ttEntry.hashMove));
+    if( ttHit && hashUsageCondition(ttEntry, tDepth, tAlpha, tBeta) && usableAtRoot){
+        mPV[tPly][0] = ttEntry.hashMove;
+        mPVLength[tPly] = 1;
+        return ttEntry.score;
+    }
+
+    // Tablebases are exact right after a capture or pawn move, when the fifty-move counter is zero.
+    // Probes make moves on the board, so they are kept clear of the end of the state stack
+    Tablebases &tablebases = Tablebases::getInstance();
+    if (mProbeTB && tPly > 0 && tPly < MAX_PLY - 8 && mBoard.getHMC() == 0 && tablebases.canProbe(mBoard)) {
+        bool success;
+        const wdlScore wdl = tablebases.probeWDL(mBoard, success);
+        if (success) {
+            mTBHits.store(mTBHits.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            const int16_t score = wdl == wdlWin ? TB_WIN - tPly : wdl == wdlLoss ? -TB_WIN + tPly : 2 * wdl;
+            const uint8_t nodeType = wdl == wdlWin ? cutNode : wdl == wdlLoss ? allNode : pvNode;
+            if (nodeType == pvNode || (nodeType == cutNode && score >= tBeta) || (nodeType == allNode && score <= tAlpha)) {
+                mTT.insert({hashKey, score, uint8_t(std::min(tDepth + 6, MAX_DEPTH)), nodeType, Move()});
+                return score;
+            }
+        }
+    }
+
+    Move bestMove;
+    int16_t bestScore = CHECKMATE - tDepth;
+    uint8_t bestNodeType = allNode;
+    MoveList &moveList = mMoveLists[tPly];
+
+    countNode();
+
+    // Selective search never applies to PV nodes, nor when the king has to get out of check
+    const bool isPV = tBeta - tAlpha > 1;
+    const bool inCheck = isCheck();
+    const bool canPrune = !isPV && !inCheck && std::abs(tBeta) < MATE_BOUND;
+    const int16_t staticEval = canPrune ? evaluate(mBoard) : CHECKMATE;
+
+    // Reverse futility: the position is so far above beta that a shallow search won't bring it back
+    if (canPrune && tDepth <= mParams.rfpDepth && staticEval - mParams.rfpMargin * tDepth >= tBeta)
+        return staticEval;
+
+    // Razoring: hopeless positions at the frontier only get a capture search
+    if (canPrune && tDepth <= mParams.razorDepth && staticEval + mParams.razorMargin * tDepth < tAlpha) {
+        const int16_t score = quiescence(tPly, tAlpha, tBeta);
+        if (score < tAlpha) return score;
+    }
+
+    // Null move: if passing still fails high the node is not worth a full search.
+    // Skipped right after another null move and with only pawns left, where zugzwang is likely
+    if (canPrune && tDepth >= mParams.nmpMinDepth && mParams.nmpMinDepth && staticEval >= tBeta
+        && tPly > 0 && mPieceToStack[tPly - 1] >= 0 && mBoard.hasNonPawnMaterial(mBoard.getSideToMove())) {
+        const int reduction = mParams.nmpBase + tDepth / std::max(mParams.nmpDivisor, 1);
+        mPieceToStack[tPly] = -1;
+        mBoard.makeNullMove();
+        mGameHist.emplace_back(mBoard.getHash());
+        const int16_t score = -alphaBeta(tDepth - 1 - reduction, tPly + 1, -tBeta, -tBeta + 1);
+        mBoard.undoNullMove();
+        mGameHist.pop_back();
+        if (exitSearch()) return DRAW;
+        if (score >= tBeta) return score >= MATE_BOUND ? tBeta : score;
+    }
+
+    // Futility: quiet moves that can't lift the static eval up to alpha are skipped at low depth
+    const bool futile = canPrune && tDepth <= mParams.futilityDepth && std::abs(tAlpha) < MATE_BOUND
+                     && staticEval + mParams.futilityMargin * tDepth <= tAlpha;
+
+    // Quiet ordering follows up on the last two moves, unless one of them was a null move
+    const int side = mBoard.getSideToMove();
+    const int prevPieceTo = tPly > 0 ? mPieceToStack[tPly - 1] : -1;
+    const std::array<History::ContTable*, 2> cont = {
+        prevPieceTo >= 0 ? mHistory.continuation(prevPieceTo) : nullptr,
+        tPly > 1 && mPieceToStack[tPly - 2] >= 0 ? mHistory.continuation(mPieceToStack[tPly - 2]) : nullptr
+    };
+    const Move counter = prevPieceTo >= 0 ? mHistory.getCounter(prevPieceTo) : Move();
+
+    const std::array<Move, 2> &killers = mKillers[tDepth-1];
+    MovePicker picker(mBoard, mGenerator, moveList, ttHit ? ttEntry.hashMove : Move(), killers, counter,
+                      mHistory, {cont[0], cont[1]});
+    std::array<Move, 64> quietsSearched;
+    int quietCount = 0;
+    int moveCount = 0;
+    for (Move move = picker.next(); move.isInit(); move = picker.next()){
+        if (tPly == 0 && !mRootMoves.empty() && std::find(mRootMoves.begin(), mRootMoves.end(), move) == mRootMoves.end())
+            continue;
+        moveCount ++;
+        const bool isQuiet = !move.isCapture() && !move.isPromo();
+        const int pieceTo = History::pieceTo(side, mBoard.searchPiece(move.from()), move.to());
+
+        if (mCopyMake) mSavedBoards[tPly] = mBoard;
+        mPieceToStack[tPly] = pieceTo;
+        mBoard.makeMove(move);
+        const bool givesCheck = isQuiet && !inCheck && isCheck();
+
+        if (futile && isQuiet && !givesCheck && moveCount > 1) {
+            if (mCopyMake) mBoard = mSavedBoards[tPly];
+            else mBoard.undoMove(move);
+            continue;
+        }
+
+        mGameHist.emplace_back(mBoard.getHash());
+
+        // Late quiet moves are searched shallower first, and again at full depth only if they beat alpha
+        int reduction = 0;
+        if (tDepth >= mParams.lmrMinDepth && mParams.lmrMinDepth && moveCount > mParams.lmrMinMoves
+            && isQuiet && !inCheck && !givesCheck && move != killers[0] && move != killers[1]) {
+            reduction = mReductions[std::min(tDepth, 63)][std::min(moveCount, 63)];
+            if (isPV) reduction --;
+            reduction = std::clamp(reduction, 0, std::max(0, tDepth - 2));
+        }
+
+        int16_t score = CHECKMATE;
+        bool fullDepth = true;
+        if (reduction) {
+            score = -alphaBeta(tDepth - 1 - reduction, tPly + 1, -tAlpha - 1, -tAlpha);
+            fullDepth = score > tAlpha;
+        }
+        // zero-window search if alpha has already been raised
+        if (fullDepth && bestNodeType == pvNode)
+            score = -alphaBeta(tDepth - 1, tPly + 1, -tAlpha - 1, -tAlpha);
+        // full window search if alpha hasn't been searched or move could raise alpha
+        if (fullDepth && (bestNodeType != pvNode || (score > tAlpha && score < tBeta)))
+            score = -alphaBeta(tDepth - 1, tPly + 1, -tBeta, -tAlpha);
+
+        if (mCopyMake) mBoard = mSavedBoards[tPly];
+        else mBoard.undoMove(move);
+        mGameHist.pop_back();
+
+        if (score > bestScore) {
+            bestScore = score;
+            bestMove = move;
+            if (bestScore > tAlpha) {
+                bestNodeType = pvNode;
+                tAlpha = bestScore;
+                updatePV(tPly, move);
+            }
+        }
+
+        // Fail high, a quiet move becomes a killer and the countermove, and earns history over the quiets tried before it
+        if (tAlpha >= tBeta){
+            if (!exitSearch() && tDepth >= ttEntry.depht)
+                mTT.insert({hashKey, bestScore, uint8_t(tDepth), cutNode, bestMove});
+            if (isQuiet && !exitSearch()) {
+                const int bonus = std::min(16 * tDepth * tDepth, 1200);
+                mHistory.update(side, move, pieceTo, cont, bonus);
+                for (int i = 0; i < quietCount; i ++) {
+                    const Move quiet = quietsSearched[i];
+                    mHistory.update(side, quiet, History::pieceTo(side, mBoard.searchPiece(quiet.from()), quiet.to()), cont, -bonus);
+                }
+                if (prevPieceTo >= 0) mHistory.setCounter(prevPieceTo, move);
+            }
+            if (!move.isCapture() && mKillers[tDepth-1][0] != move){
+                mKillers[tDepth-1][1] = mKillers[tDepth-1][0];
+                mKillers[tDepth-1][0] = move;
+            }
+            return bestScore;
+        }
+        if (isQuiet && quietCount < int(quietsSearched.size())) quietsSearched[quietCount ++] = move;
+    }
+
+    if(!exitSearch() && tDepth >= ttEntry.depht){
+        if (bestScore == CHECKMATE - tDepth && !inCheck) bestScore = DRAW;
+        mTT.insert({hashKey, bestScore, uint8_t(tDepth), bestNodeType, bestMove});
+    }
+
+    return bestScore;
+}
+
+int16_t Worker::quiescence(int tPly, int16_t tAlpha, int16_t tBeta)
+{
+    countNode();
+
+    static constexpr int16_t pieceVal[7] = {0, 0, 100, 300, 300, 500, 1000};
+    int16_t standPat = evaluate(mBoard);
+    if (tPly >= MAX_PLY - 1) return standPat;
+
+    int16_t bestScore;
+    MoveList &moveList = mMoveLists[tPly];
+
+    const bool inCheck = isCheck();
+    if (inCheck){
+        bestScore = CHECKMATE;
+    }
+    else{
+        bestScore = standPat;
+        if(bestScore > tAlpha) {
+            tAlpha = bestScore;
+            if(tAlpha >= tBeta) return bestScore;
+        }
+        else if(bestScore + (promoThreat() ? 1800 : 1000) < tAlpha)
+            return bestScore;
+    }
+
+    MovePicker picker(mBoard, mGenerator, moveList, inCheck);
+    for (Move move = picker.next(); move.isInit(); move = picker.next()){
+        // Delta and SEE pruning, both decided before touching the board
+        if (!inCheck){
+            const int captured = move.isEnPassant() ? pawn : mBoard.searchPiece(move.to());
+            if (standPat + pieceVal[captured] + 200 <= tAlpha || !mGenerator.see(mBoard, move, 0))
+                continue;
+        }
+
+        if (mCopyMake) mSavedBoards[tPly] = mBoard;
+        mBoard.makeMove(move);
+        int16_t score = -quiescence(tPly + 1, -tBeta, -tAlpha);
+        if (mCopyMake) mBoard = mSavedBoards[tPly];
+        else mBoard.undoMove(move);
+
+        if (score > bestScore) {
+            bestScore = score;
+            if (bestScore > tAlpha) tAlpha = bestScore;
+        }
+
+        if(tAlpha >= tBeta) return bestScore;
+    }
+
+    return bestScore;
+}
+
+void Worker::updatePV(int tPly, Move tMove)
+{
+    mPV[tPly][0] = tMove;
+    std::copy_n(mPV[tPly + 1].begin(), mPVLength[tPly + 1], mPV[tPly].begin() + 1);
+    mPVLength[tPly] = mPVLength[tPly + 1] + 1;
+}
+
+bool Worker::isCheck()
+{
+    const int stm = mBoard.getSideToMove();
+    const int kingSquare = mBoard.getKingSquare(stm);
+    return mGenerator.isAttacked(mBoard, kingSquare, 1 - stm);
+}
+
+bool Worker::promoThreat()
+{
+    static constexpr uint64_t seventhRank[2] = {uint64_t(0x00ff000000000000), uint64_t(0x000000000000ff00)};
+    const int stm = mBoard.getSideToMove();
+    return mBoard.getBitboard(pawn) & mBoard.getBitboard(stm) & seventhRank[stm];
+}
+
+bool Worker::hashUsageCondition(TTEntry tTTVal, int tDepht, int tAlpha, int tBeta)
+{
+    return tTTVal.depht >= tDepht && (
+            (tTTVal.nodeType == pvNode)
+            || (tTTVal.nodeType == allNode && tTTVal.score <= tAlpha)
+            || (tTTVal.nodeType == cutNode && tTTVal.score >= tBeta )
+        );
+}
+
+bool Worker::threefoldRepetition()
+{
+    int repetition = 1;
+    const int revPlies = mBoard.getHMC(); // number of plies with reversible moves
+    const int histSize = mGameHist.size(); // lenght of current game
+    const int maxPlies = std::min(histSize - 1, revPlies);
+
+    if (maxPlies < 8) return false; // not enough reversible moves for threefold rep
+    for (int ply = 2; ply <= maxPlies; ply += 2){ // checks every even spaced key for repetition (excluding the second last)
+        if(mGameHist[(histSize - 1) - ply] ==  mGameHist.back()) {
+            repetition += 1;
+            if(repetition == 3) return true;
+        }
+    }
+    return false;
+}
+
+bool Worker::fiftyMove()
+{
+    const int revPlies = mBoard.getHMC(); // number of plies with reversible moves
+    return revPlies >= 100;
+}
+
+bool Worker::exitSearch()
+{
+    // Once raised the stop stays latched, so an aborted iteration can't be mistaken for a complete one
+    if (mStopped)
+        return true;
+    // The main thread always completes depth 1, so that it has a searched move to report
+    else if (mId == 0 && mIterationDepth <= 1)
+        return false;
+    else if (!mGoSearch.load(std::memory_order_relaxed))
+        return mStopped = true;
+    else if (mId != 0)
+        return false;
+    // Summing the counters of every thread touches their cache lines, so the node limit is checked
+    // as sparingly as the clock
+    else if (mLimits.nodes && (getSearchedNodes() & 1023) == 0 && poolNodes() > mLimits.nodes)
+        return mStopped = true;
+    else if ((getSearchedNodes() & 1023) == 0 && mTime.hardLimitReached())
+        return mStopped = true;
+    else
+        return false;
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <vector>
+#include <array>
+#include <atomic>
+#include <memory>
+
+#include "Board.hpp"
+#include "History.hpp"
+#include "Move.hpp"
+#include "MoveGenerator.hpp"
+#include "MoveList.hpp"
+#include "utils.hpp"
+#include "TT.hpp"
+#include "TimeManager.hpp"
+
+class Worker
+{
+public:
+    /**
+     * @brief Constructs a search thread context sharing the given hash table
+     *
+     * @param tId Thread index, 0 is the main thread that reports and checks limits
+     * @param tTT Transposition table shared among all workers
+     * @param tGoSearch Flag that stops the search when set to false
+     * @param tPool Every worker taking part in the search, used to sum node counts
+     */
+    Worker(int tId, TT &tTT, const std::atomic<bool> &tGoSearch, const std::vector<std::unique_ptr<Worker>> &tPool) :
+        mId{tId}, mTT{tTT}, mGoSearch{tGoSearch}, mPool{tPool}, mBoard{Board(STARTPOS)} {setParams(mParams);}
+
+    /**
+     * @brief Sets the root position and the game history leading to it
+     *
+     * @param tBoard Root position
+     * @param tGameHist Zobrist keys of the positions played so far
+     * @param tRootMoves Root moves to search, all of them if empty. Tablebases are not probed
+     * during the search when the root moves come from them
+     */
+    void setPos(const Board &tBoard, const std::vector<uint64_t> &tGameHist, const MoveList &tRootMoves = MoveList());
+
+    /**
+     * @brief Iterative deepening loop, returns when the search is stopped or limits are hit
+     *
+     * @param tMaxDepth Deepest iteration to search
+     * @param tLimits Search parameters as per SearchLimits specification
+     */
+    void iterate(int tMaxDepth, SearchLimits tLimits);
+
+    inline void setCopyMake(bool tCopyMake) {mCopyMake = tCopyMake;}
+    inline void setSilent(bool tSilent) {mSilent = tSilent;}   // no info lines, for searches nobody is listening to
+    inline void clearHistory() {mHistory.clear();}
+
+    /**
+     * @brief Sets the selective search parameters and rebuilds the reduction table
+     *
+     * @param tParams Parameters as per SearchParams specification
+     */
+    void setParams(const SearchParams &tParams);
+
+    inline uint64_t getSearchedNodes() const {return mSearchedNodes.load(std::memory_order_relaxed);}
+    inline uint64_t getTBHits() const {return mTBHits.load(std::memory_order_relaxed);}
+    inline int      getCompletedDepth() const {return mCompletedDepth;}
+    inline int16_t  getScore() const {return mScore;}
+    inline Move     getBestMove() const {return mBestMove;}
+    inline TimePoint getBestMoveTime() const {return mBestMoveTime;}   // elapsed since which the best move stayed the same
+    inline uint64_t getBestMoveNodes() const {return mBestMoveNodes;} // nodes searched by then
+
+private:
+    bool exitSearch();
+    uint64_t poolNodes() const;
+    uint64_t poolTBHits() const;
+    inline void countNode() {mSearchedNodes.store(mSearchedNodes.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);}
+
+    void printSearchInfo(int tMaxDepth, int64_t tElapsed, int16_t tEval);
+    int16_t alphaBeta(int tDepht, int tPly, int16_t tAlpha, int16_t tBeta);
+    int16_t quiescence(int tPly, int16_t tAlpha, int16_t tBeta);
+    void updatePV(int tPly, Move tMove);
+
+    bool isCheck();   // opponent side gives check and its your turn
+    bool promoThreat();
+
+    bool hashUsageCondition(TTEntry tTTVal, int tDepht, int tAlpha, int tBeta);
+    bool threefoldRepetition();
+    bool fiftyMove();
+
+private:
+    const int mId;
+    TT &mTT;
+    const std::atomic<bool> &mGoSearch;
+    const std::vector<std::unique_ptr<Worker>> &mPool;
+
+    const MoveGenerator mGenerator;
+    std::vector<std::array<Move, 2>> mKillers;
+    History mHistory;   // kept across searches of the same game, only aged
+    std::vector<uint64_t> mGameHist;
+    Board mBoard;
+    MoveList mRootMoves;
+    bool mProbeTB = true;
+    bool mCopyMake = false;
+    bool mSilent = false;
+    SearchParams mParams;
+    std::array<std::array<uint8_t, 64>, 64> mReductions {};  // late move reductions by depth and move count
+
+    // Search stack, preallocated so that the search itself never touches the heap
+    std::array<MoveList, MAX_PLY> mMoveLists;
+    std::array<Board, MAX_PLY> mSavedBoards;   // parent positions when copy-making
+    std::array<int, MAX_PLY + 1> mPieceToStack; // History::pieceTo of the move played at each ply, -1 for a null move
+    std::array<std::array<Move, MAX_PLY>, MAX_PLY + 1> mPV; // triangular PV table
+    std::array<int, MAX_PLY + 1> mPVLength {};
+    SearchLimits mLimits;
+    TimeManager mTime;
+    bool mStopped = false;
+    int mIterationDepth = 0;
+
+    std::atomic<uint64_t> mSearchedNodes = 0;
+    std::atomic<uint64_t> mTBHits = 0;
+    int mCompletedDepth = -1;
+    int16_t mScore = 0;
+    Move mBestMove;
+    TimePoint mBestMoveTime = 0;
+    uint64_t mBestMoveNodes = 0;
+};
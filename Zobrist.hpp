@@ -2,8 +2,9 @@
 
 #include <array>
 #include <cstdint>
-#include <random>
 
+// Keys are drawn from a splitmix64 stream at compile time, so hashing a
+// position never has to go through a lazily built instance
 class Zobrist
 {
 public:
@@ -11,35 +12,43 @@ public:
     Zobrist(const Zobrist&)             =delete;
     Zobrist& operator=(const Zobrist&)  =delete;
 
-    static const Zobrist& getInstance();
+    static inline const Zobrist& getInstance() {return mInstance;}
 
-    static constexpr int PIECE_OFFSET[7] = {0, 0, 64, 128, 192, 256, 320};
+    static constexpr int PIECE_OFFSET[8] = {0, 0, 0, 64, 128, 192, 256, 320};
     static constexpr int SIDE_OFFSET[2] = { 0, 384 };
-    inline uint64_t getPieceKey(int tSTM, int tPiece, int tSquare) const {
-        return mPieceKeys[SIDE_OFFSET[tSTM] + PIECE_OFFSET[tPiece] + tSquare];
+    static constexpr uint64_t getPieceKey(int tSTM, int tPiece, int tSquare) {
+        return mKeys[SIDE_OFFSET[tSTM] + PIECE_OFFSET[tPiece] + tSquare];
     }
     
-    inline uint64_t getCastleKey(int tCastleFlag) const {return mCastleKeys[tCastleFlag];}
-    inline uint64_t getEPKey(int tEPFile) const {return mEPKeys[tEPFile];}
-    inline uint64_t getSTMKey() const {return mSTMKey;}
+    static constexpr uint64_t getCastleKey(int tCastleFlag) {return mKeys[CASTLE_OFFSET + tCastleFlag];}
+    static constexpr uint64_t getEPKey(int tEPFile) {return mKeys[EP_OFFSET + tEPFile];}
+    static constexpr uint64_t getSTMKey() {return mKeys[STM_OFFSET];}
 
 private:
-
-    Zobrist();
-    ~Zobrist() {delete mInstance; mInstance = nullptr;}
-
-    void initPieces();
-    void initCastle();
-    void initEP();
-    void initSideToMove();
+    constexpr Zobrist() = default;
+
+    // 768 piece keys, 16 castling keys, 8 en passant files, side to move
+    static constexpr int CASTLE_OFFSET = 768;
+    static constexpr int EP_OFFSET = CASTLE_OFFSET + 16;
+    static constexpr int STM_OFFSET = EP_OFFSET + 8;
+    static constexpr int KEY_COUNT = STM_OFFSET + 1;
+
+    static constexpr std::array<uint64_t, KEY_COUNT> initKeys() {
+        std::array<uint64_t, KEY_COUNT> keys {};
+        uint64_t state = 5829046653945461000ULL;
+        for (uint64_t &key : keys) {
+            uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+            key = z ^ (z >> 31);
+        }
+        return keys;
+    }
 
 private:
-    static Zobrist* mInstance;
-
-    std::array<uint64_t, 768> mPieceKeys;
-    std::array<uint64_t, 16> mCastleKeys;
-    std::array<uint64_t, 8> mEPKeys;
-    uint64_t mSTMKey;
-
-    std::mt19937_64 mRng;
+    static const Zobrist mInstance;
+    static const std::array<uint64_t, KEY_COUNT> mKeys;
 };
+
+inline constexpr Zobrist Zobrist::mInstance {};
+inline constexpr std::array<uint64_t, Zobrist::KEY_COUNT> Zobrist::mKeys = Zobrist::initKeys();
@@ -0,0 +1,211 @@
+// Microbenchmarks of the search hot paths over the bench positions.
+// Every benchmark reports the time of a single operation as time/op
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "Board.hpp"
+#include "MagicBitboards.hpp"
+#include "Move.hpp"
+#include "MoveGenerator.hpp"
+#include "MoveList.hpp"
+#include "TT.hpp"
+#include "bench.hpp"
+#include "evaluation.hpp"
+#include "notation.hpp"
+
+namespace {
+
+const MoveGenerator generator;
+
+const std::vector<Board>& corpus()
+{
+    static const std::vector<Board> boards = [] {
+        std::vector<Board> positions;
+        for (const char *fen : BENCH_POSITIONS) positions.emplace_back(fen);
+        return positions;
+    }();
+    return boards;
+}
+
+// Pseudo random keys and occupancies that don't depend on the platform
+inline uint64_t splitmix64(uint64_t &tState)
+{
+    uint64_t z = (tState += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+inline void setOps(benchmark::State &tState, int64_t tOps)
+{
+    tState.SetItemsProcessed(tOps);
+    tState.counters["time/op"] = benchmark::Counter(double(tOps), benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+}
+
+void BM_MakeUndo(benchmark::State &tState)
+{
+    std::vector<Board> boards = corpus();
+    std::vector<MoveList> moves(boards.size());
+    for (size_t i = 0; i < boards.size(); i ++) generator.legal(boards[i], moves[i]);
+
+    int64_t ops = 0;
+    for (auto _ : tState) {
+        for (size_t i = 0; i < boards.size(); i ++) {
+            for (Move move : moves[i]) {
+                boards[i].makeMove(move);
+                boards[i].undoMove(move);
+            }
+            benchmark::DoNotOptimize(boards[i]);
+            ops += moves[i].size();
+        }
+    }
+    setOps(tState, ops);
+}
+BENCHMARK(BM_MakeUndo);
+
+void BM_CopyMake(benchmark::State &tState)
+{
+    const std::vector<Board> &boards = corpus();
+    std::vector<MoveList> moves(boards.size());
+    for (size_t i = 0; i < boards.size(); i ++) generator.legal(boards[i], moves[i]);
+
+    int64_t ops = 0;
+    for (auto _ : tState) {
+        for (size_t i = 0; i < boards.size(); i ++) {
+            for (Move move : moves[i]) {
+                Board child = boards[i];
+                child.makeMove(move);
+                benchmark::DoNotOptimize(child);
+            }
+            ops += moves[i].size();
+        }
+    }
+    setOps(tState, ops);
+}
+BENCHMARK(BM_CopyMake);
+
+void BM_GenerateAll(benchmark::State &tState)
+{
+    const std::vector<Board> &boards = corpus();
+    MoveList moves;
+
+    int64_t ops = 0;
+    for (auto _ : tState) {
+        for (const Board &board : boards) {
+            moves.clear();
+            generator.all(board, moves);
+            benchmark::DoNotOptimize(moves);
+        }
+        ops += boards.size();
+    }
+    setOps(tState, ops);
+}
+BENCHMARK(BM_GenerateAll);
+
+void BM_GenerateLegal(benchmark::State &tState)
+{
+    const std::vector<Board> &boards = corpus();
+    MoveList moves;
+
+    int64_t ops = 0;
+    for (auto _ : tState) {
+        for (const Board &board : boards) {
+            moves.clear();
+            generator.legal(board, moves);
+            benchmark::DoNotOptimize(moves);
+        }
+        ops += boards.size();
+    }
+    setOps(tState, ops);
+}
+BENCHMARK(BM_GenerateLegal);
+
+void BM_IsAttacked(benchmark::State &tState)
+{
+    const std::vector<Board> &boards = corpus();
+
+    int64_t ops = 0;
+    for (auto _ : tState) {
+        for (const Board &board : boards) {
+            for (int square = a1; square <= h8; square ++)
+                benchmark::DoNotOptimize(generator.isAttacked(board, square, board.getSideToMove()));
+        }
+        ops += boards.size() * 64;
+    }
+    setOps(tState, ops);
+}
+BENCHMARK(BM_IsAttacked);
+
+void BM_Evaluate(benchmark::State &tState)
+{
+    const std::vector<Board> &boards = corpus();
+
+    int64_t ops = 0;
+    for (auto _ : tState) {
+        for (const Board &board : boards) benchmark::DoNotOptimize(evaluate(board));
+        ops += boards.size();
+    }
+    setOps(tState, ops);
+}
+BENCHMARK(BM_Evaluate);
+
+// Occupancies of the corpus, so that rays are blocked as they are in games
+void BM_SliderAttacks(benchmark::State &tState)
+{
+    const int piece = int(tState.range(0));
+    std::vector<uint64_t> occupancies;
+    for (const Board &board : corpus()) occupancies.push_back(board.getBitboard(white) | board.getBitboard(black));
+
+    int64_t ops = 0;
+    for (auto _ : tState) {
+        for (uint64_t occupied : occupancies)
+            for (int square = a1; square <= h8; square ++)
+                benchmark::DoNotOptimize(MagicBitboards::getAttacks(piece, square, occupied));
+        ops += occupancies.size() * 64;
+    }
+    setOps(tState, ops);
+    tState.SetLabel(MagicBitboards::usesPext() ? "pext" : "magic");
+}
+BENCHMARK(BM_SliderAttacks)->Arg(bishop)->Arg(rook)->Arg(queen);
+
+// Random keys over the whole table: with a table larger than the caches every probe is a miss,
+// while a 1 MB table mostly stays in L2
+void BM_TTProbe(benchmark::State &tState)
+{
+    TT tt(size_t(tState.range(0)));
+    uint64_t seed = 1;
+    std::vector<uint64_t> keys(1 << 20);
+    for (uint64_t &key : keys) key = splitmix64(seed);
+    for (size_t i = 0; i < keys.size(); i += 2) tt.insert({keys[i], 0, 1, pvNode, Move()});
+
+    int64_t ops = 0;
+    for (auto _ : tState) {
+        for (uint64_t key : keys) benchmark::DoNotOptimize(tt.probe(key));
+        ops += keys.size();
+    }
+    setOps(tState, ops);
+}
+BENCHMARK(BM_TTProbe)->Arg(1)->Arg(16)->Arg(256);
+
+void BM_TTInsert(benchmark::State &tState)
+{
+    TT tt(size_t(tState.range(0)));
+    uint64_t seed = 2;
+    std::vector<uint64_t> keys(1 << 20);
+    for (uint64_t &key : keys) key = splitmix64(seed);
+
+    int64_t ops = 0;
+    uint8_t depth = 0;
+    for (auto _ : tState) {
+        for (uint64_t key : keys) tt.insert({key, 0, uint8_t(++ depth & 0x3f), cutNode, Move()});
+        ops += keys.size();
+    }
+    setOps(tState, ops);
+}
+BENCHMARK(BM_TTInsert)->Arg(1)->Arg(16)->Arg(256);
+
+}
+
+BENCHMARK_MAIN();
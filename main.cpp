@@ -1,6 +1,50 @@
 #include "UCI.hpp"
+#include "Engine.hpp"
+#include "Datagen.hpp"
+#include "TestSuite.hpp"
+#include "Tuner.hpp"
+#include "bench.hpp"
+#include <cstdlib>
+#include <sstream>
+#include <string>
+
+int main(int argc, char* argv[]){
+   // "engine bench [depth] [threads]" runs the bench suite and exits, for regression scripts
+   if (argc > 1 && std::string(argv[1]) == "bench") {
+      Engine engine;
+      engine.bench(argc > 2 ? std::atoi(argv[2]) : BENCH_DEPTH, argc > 3 ? std::atoi(argv[3]) : 1);
+      return 0;
+   }
+
+   // "engine datagen [<name> <value>]..." plays self-play games for training data, see DatagenConfig
+   if (argc > 1 && std::string(argv[1]) == "datagen") {
+      std::stringstream args;
+      for (int i = 2; i < argc; i ++) args << argv[i] << ' ';
+      DatagenConfig config;
+      config.parse(args);
+      Datagen(config).run();
+      return 0;
+   }
+
+   // "engine tune data <file> [<name> <value>]..." fits the PST tables to game results, see TunerConfig
+   if (argc > 1 && std::string(argv[1]) == "tune") {
+      std::stringstream args;
+      for (int i = 2; i < argc; i ++) args << argv[i] << ' ';
+      TunerConfig config;
+      config.parse(args);
+      return Tuner(config).run() ? 0 : 1;
+   }
+
+   // "engine testsuite file <epd> [<name> <value>]..." runs a bm/am test suite, see TestSuiteConfig
+   if (argc > 1 && std::string(argv[1]) == "testsuite") {
+      std::stringstream args;
+      for (int i = 2; i < argc; i ++) args << argv[i] << ' ';
+      TestSuiteConfig config;
+      config.parse(args);
+      TestSuite(config).run();
+      return 0;
+   }
 
-int main(){
    UCI interface;
    interface.loop();
-}
\ No newline at end of file
+}
@@ -2,6 +2,8 @@
 
 #define CHECKMATE  (INT16_MIN / 2)
 #define DRAW 0
+#define MAX_DEPTH 99
+#define MAX_PLY 128
 #define STARTPOS "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"
 #define KIWIPETE "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1"
 #define ENDGAME "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1 "
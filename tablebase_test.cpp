@@ -0,0 +1,1159 @@
+#include "Board.hpp"
+#include "Engine.hpp"
+#include "MagicBitboards.hpp"
+#include "Move.hpp"
+#include "MoveGenerator.hpp"
+#include "MoveList.hpp"
+#include "Tablebases.hpp"
+#include "notation.hpp"
+#include "utils.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <queue>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Checks the Syzygy probing code against tables built here. A retrograde solver computes every position
+// of a few small endgames, the results are written in the Syzygy format and read back through Tablebases.
+// Official tables can't be fetched by the test, so this validates the decoding and probing logic against
+// an independent solution of the endgames, not byte for byte against files of the official generator
+
+namespace {
+
+constexpr int MAX_MEN = 4;
+constexpr int MAX_MOVES = 128;
+constexpr int8_t INVALID = 127, UNKNOWN = -128;
+
+const std::string pieceChars = "  PNBRQK";
+
+struct Man {
+    int color, type, square;
+};
+
+// -------------------------------------------------------------------------------------------------------
+// Retrograde solver
+// -------------------------------------------------------------------------------------------------------
+
+// Solver order: white king, black king, then the other white and black men from the most valuable down
+inline int orderOf(const Man &tMan) {return tMan.type == king ? tMan.color : 2 + tMan.color * 8 + queen - tMan.type;}
+
+void sortMen(Man *tMen, int tCount)
+{
+    std::sort(tMen, tMen + tCount, [](const Man &a, const Man &b) {return orderOf(a) < orderOf(b);});
+}
+
+uint64_t keyOf(const Man *tMen, int tCount)
+{
+    uint64_t key = 0;
+    for (int i = 0; i < tCount; i ++)
+        if (tMen[i].type != king) key += uint64_t(1) << (4 * (tMen[i].color * 8 + tMen[i].type));
+    return key;
+}
+
+// Symmetries of the board: file flip, rank flip and a1-h8 transposition
+inline int transform(int tSymmetry, int tSquare)
+{
+    if (tSymmetry & 1) tSquare ^= 7;
+    if (tSymmetry & 2) tSquare ^= 56;
+    if (tSymmetry & 4) tSquare = ((tSquare >> 3) | (tSquare << 3)) & 63;
+    return tSquare;
+}
+
+inline bool inTriangle(int tSquare) {return (tSquare & 7) <= 3 && (tSquare >> 3) <= (tSquare & 7);}
+
+// Pawnless tables keep the white king in the a1-d1-d4 triangle, identity for the squares already in it
+struct Triangle {
+    int symmetry[64] {};
+    int index[64] {};
+    int squares[10] {};
+
+    Triangle() {
+        int count = 0;
+        for (int square = a1; square <= h8; square ++) {
+            if (inTriangle(square)) {
+                index[square] = count;
+                squares[count ++] = square;
+            }
+            for (int s = 0; s < 8; s ++)
+                if (inTriangle(transform(s, square))) {
+                    symmetry[square] = s;
+                    break;
+                }
+        }
+    }
+};
+
+const Triangle triangle;
+
+struct Table {
+    std::string name;
+    int count = 0;
+    int colors[MAX_MEN] {};
+    int types[MAX_MEN] {};
+    bool hasPawns = false;
+    bool reduced = false;       // white king in the a1-d1-d4 triangle, pawnless tables only
+    std::vector<int8_t> wdl;    // side to move point of view, INVALID for illegal placements
+    std::vector<uint8_t> dtz;   // plies to the next capture, pawn move or mate of decided positions
+
+    size_t index(const int *tSquares, int tSTM) const {
+        size_t idx = size_t(tSTM);
+        if (reduced) {
+            const int symmetry = triangle.symmetry[tSquares[0]];
+            idx = idx * 10 + triangle.index[transform(symmetry, tSquares[0])];
+            for (int i = 1; i < count; i ++) idx = idx * 64 + transform(symmetry, tSquares[i]);
+        }
+        else for (int i = 0; i < count; i ++) idx = idx * 64 + tSquares[i];
+        return idx;
+    }
+
+    void decode(size_t tIdx, int *outSquares, int &outSTM) const {
+        for (int i = count - 1; i >= int(reduced); i --, tIdx /= 64) outSquares[i] = int(tIdx % 64);
+        if (reduced) {
+            outSquares[0] = triangle.squares[tIdx % 10];
+            tIdx /= 10;
+        }
+        outSTM = int(tIdx);
+    }
+};
+
+struct SolverMove {
+    int man, to, captured, promotion;
+};
+
+bool attacked(const Table &tTable, const int *tSquares, int tTarget, int tBy, uint64_t tOccupied, int tSkip = -1)
+{
+    for (int i = 0; i < tTable.count; i ++) {
+        if (i == tSkip || tTable.colors[i] != tBy) continue;
+        const uint64_t attacks = tTable.types[i] == pawn ? MagicBitboards::pawnAttacks(tSquares[i], tBy)
+                               : MagicBitboards::getAttacks(tTable.types[i], tSquares[i], tOccupied);
+        if (attacks >> tTarget & 1) return true;
+    }
+    return false;
+}
+
+uint64_t occupancy(const Table &tTable, const int *tSquares)
+{
+    uint64_t occupied = 0;
+    for (int i = 0; i < tTable.count; i ++) occupied |= uint64_t(1) << tSquares[i];
+    return occupied;
+}
+
+bool isLegal(const Table &tTable, const int *tSquares, int tSTM)
+{
+    const uint64_t occupied = occupancy(tTable, tSquares);
+    if (popCount(occupied) != tTable.count) return false;
+    for (int i = 0; i < tTable.count; i ++)
+        if (tTable.types[i] == pawn && (tSquares[i] >> 3 == 0 || tSquares[i] >> 3 == 7)) return false;
+    return !attacked(tTable, tSquares, tSquares[1 - tSTM], tSTM, occupied);
+}
+
+// Legal moves without en passant, tables with pawns on both sides are not generated
+int generate(const Table &tTable, const int *tSquares, int tSTM, SolverMove *outMoves)
+{
+    uint64_t occupied = 0, own = 0;
+    for (int i = 0; i < tTable.count; i ++) {
+        occupied |= uint64_t(1) << tSquares[i];
+        if (tTable.colors[i] == tSTM) own |= uint64_t(1) << tSquares[i];
+    }
+
+    int count = 0;
+    for (int i = 0; i < tTable.count; i ++) {
+        if (tTable.colors[i] != tSTM) continue;
+        const int from = tSquares[i];
+        uint64_t targets;
+        if (tTable.types[i] == pawn) {
+            const int push = tSTM == white ? 8 : -8;
+            targets = MagicBitboards::pawnAttacks(from, tSTM) & occupied & ~own;
+            if (!(occupied >> (from + push) & 1)) {
+                targets |= uint64_t(1) << (from + push);
+                if (from >> 3 == (tSTM == white ? 1 : 6) && !(occupied >> (from + 2 * push) & 1))
+                    targets |= uint64_t(1) << (from + 2 * push);
+            }
+        }
+        else targets = MagicBitboards::getAttacks(tTable.types[i], from, occupied) & ~own;
+
+        while (targets) {
+            const int to = bitScanForward(targets);
+            targets &= targets - 1;
+            int captured = -1;
+            for (int j = 0; j < tTable.count; j ++) if (tSquares[j] == to) captured = j;
+
+            int after[MAX_MEN];
+            std::copy(tSquares, tSquares + tTable.count, after);
+            after[i] = to;
+            if (attacked(tTable, after, after[tSTM], 1 - tSTM, (occupied ^ uint64_t(1) << from) | uint64_t(1) << to, captured))
+                continue;
+
+            if (tTable.types[i] == pawn && (to >> 3 == 0 || to >> 3 == 7))
+                for (int promotion = queen; promotion >= knight; promotion --) outMoves[count ++] = {i, to, captured, promotion};
+            else outMoves[count ++] = {i, to, captured, 0};
+        }
+    }
+    return count;
+}
+
+// Solves endgames on demand, along with every smaller one their captures and promotions lead to
+class Solver
+{
+public:
+    Table& get(const std::string &tName) {
+        Man men[MAX_MEN];
+        int count = 0;
+        const size_t separator = tName.find('v');
+        for (size_t i = 0; i < tName.size(); i ++)
+            if (i != separator) men[count ++] = {i > separator, int(pieceChars.find(tName[i])), 0};
+        return get(men, count);
+    }
+
+    // Outcome and DTZ of any position of a solved material, men in any order
+    int8_t probe(const Man *tMen, int tCount, int tSTM, int *outDTZ = nullptr) {
+        Man men[MAX_MEN];
+        std::copy(tMen, tMen + tCount, men);
+        sortMen(men, tCount);
+        const Table &table = get(men, tCount);
+        int squares[MAX_MEN];
+        for (int i = 0; i < tCount; i ++) squares[i] = men[i].square;
+        const size_t idx = table.index(squares, tSTM);
+        if (outDTZ) *outDTZ = table.dtz[idx];
+        return table.wdl[idx];
+    }
+
+private:
+    Table& get(Man *tMen, int tCount) {
+        sortMen(tMen, tCount);
+        const uint64_t key = keyOf(tMen, tCount);
+        auto it = mTables.find(key);
+        if (it != mTables.end()) return *it->second;
+
+        auto table = std::make_unique<Table>();
+        std::string sides[2] = {"K", "K"};
+        for (int i = 0; i < tCount; i ++) {
+            table->colors[i] = tMen[i].color;
+            table->types[i] = tMen[i].type;
+            table->hasPawns |= tMen[i].type == pawn;
+            if (tMen[i].type != king) sides[tMen[i].color] += pieceChars[tMen[i].type];
+        }
+        table->name = sides[white] + "v" + sides[black];
+        table->count = tCount;
+        table->reduced = !table->hasPawns;
+        Table &result = *(mTables[key] = std::move(table));
+        solve(result);
+        return result;
+    }
+
+    void solve(Table &tTable);
+
+    std::unordered_map<uint64_t, std::unique_ptr<Table>> mTables;
+};
+
+void Solver::solve(Table &tTable)
+{
+    size_t size = tTable.reduced ? 20 : 128;
+    for (int i = 1; i < tTable.count; i ++) size *= 64;
+    tTable.wdl.assign(size, INVALID);
+    tTable.dtz.assign(size, 0);
+
+    SolverMove moves[MAX_MOVES];
+    int squares[MAX_MEN], after[MAX_MEN], stm;
+    std::vector<bool> mated(size);
+
+    for (size_t idx = 0; idx < size; idx ++) {
+        tTable.decode(idx, squares, stm);
+        if (!isLegal(tTable, squares, stm)) continue;
+        tTable.wdl[idx] = UNKNOWN;
+        if (generate(tTable, squares, stm, moves)) continue;
+        mated[idx] = attacked(tTable, squares, squares[stm], 1 - stm, occupancy(tTable, squares));
+        tTable.wdl[idx] = mated[idx] ? -2 : 0;
+        tTable.dtz[idx] = mated[idx];
+    }
+
+    // Outcome of a move for the side that plays it, or the index of the position it leads to when it
+    // stays in the table. Captures and promotions go to smaller tables
+    auto play = [&](const SolverMove &tMove, size_t &outIdx) -> int {
+        if (tMove.captured < 0 && !tMove.promotion) {
+            std::copy(squares, squares + tTable.count, after);
+            after[tMove.man] = tMove.to;
+            outIdx = tTable.index(after, 1 - stm);
+            return UNKNOWN;
+        }
+        Man men[MAX_MEN];
+        int count = 0;
+        for (int i = 0; i < tTable.count; i ++) {
+            if (i == tMove.captured) continue;
+            men[count ++] = {tTable.colors[i], i == tMove.man && tMove.promotion ? tMove.promotion : tTable.types[i],
+                             i == tMove.man ? tMove.to : squares[i]};
+        }
+        return -probe(men, count, 1 - stm);
+    };
+
+    // With pawns, pawn moves stay in the table but zero the fifty-move counter: their outcome has to be
+    // known before counting plies, so the plain outcome comes first from a fixed point iteration
+    std::vector<int8_t> outcome;
+    if (tTable.hasPawns) {
+        outcome = tTable.wdl;
+        for (bool changed = true; changed; ) {
+            changed = false;
+            for (size_t idx = 0; idx < size; idx ++) {
+                if (outcome[idx] != UNKNOWN) continue;
+                tTable.decode(idx, squares, stm);
+                const int count = generate(tTable, squares, stm, moves);
+                bool win = false, allLose = true;
+                for (int i = 0; i < count && !win; i ++) {
+                    size_t child;
+                    int value = play(moves[i], child);
+                    if (value == UNKNOWN) value = outcome[child] == UNKNOWN ? UNKNOWN : -outcome[child];
+                    win = value == 2;
+                    allLose &= value == -2;
+                }
+                if (win || allLose) {
+                    outcome[idx] = win ? 2 : -2;
+                    changed = true;
+                }
+            }
+        }
+        for (int8_t &value : outcome) if (value == UNKNOWN) value = 0;
+    }
+
+    // Moves leaving the table, pawn moves and mates have a known outcome and count as one ply. Positions
+    // decided by them start the retrograde analysis, the others wait for their moves within the table
+    std::vector<uint8_t> pending(size);
+    std::vector<int8_t> bestExit(size, -3);
+    std::vector<size_t> level, next;
+
+    for (size_t idx = 0; idx < size; idx ++) {
+        if (mated[idx]) level.push_back(idx);
+        if (tTable.wdl[idx] != UNKNOWN) continue;
+        tTable.decode(idx, squares, stm);
+        const int count = generate(tTable, squares, stm, moves);
+        for (int i = 0; i < count; i ++) {
+            size_t child;
+            int value = play(moves[i], child);
+            if (value == UNKNOWN) {
+                if (tTable.types[moves[i].man] == pawn) value = -outcome[child];
+                else if (mated[child]) value = 2;
+                else {
+                    pending[idx] ++;
+                    continue;
+                }
+            }
+            bestExit[idx] = int8_t(std::max(int(bestExit[idx]), value));
+        }
+        if (bestExit[idx] == 2 || !pending[idx]) {
+            tTable.wdl[idx] = bestExit[idx];
+            tTable.dtz[idx] = bestExit[idx] != 0;
+            if (bestExit[idx]) level.push_back(idx);
+        }
+    }
+
+    // Every predecessor of a lost position wins one ply later, a position whose moves all reach won ones
+    // loses one ply after the last of them. Pawnless tables get the predecessors of every symmetric copy
+    for (int ply = 1; !level.empty(); ply ++) {
+        if (ply >= 100) {
+            std::cout << "cursed results in " << tTable.name << " are not supported" << std::endl;
+            std::exit(1);
+        }
+        next.clear();
+        for (size_t idx : level) {
+            tTable.decode(idx, squares, stm);
+            const int mover = 1 - stm;
+            int copies[8][MAX_MEN];
+            int copyCount = 0;
+            for (int s = 0; s < (tTable.reduced ? 8 : 1); s ++) {
+                int *copy = copies[copyCount];
+                for (int i = 0; i < tTable.count; i ++) copy[i] = transform(s, squares[i]);
+                if (tTable.index(copy, stm) != idx) continue;
+                bool duplicate = false;
+                for (int c = 0; c < copyCount; c ++)
+                    duplicate |= std::equal(copy, copy + tTable.count, copies[c]);
+                if (!duplicate) copyCount ++;
+            }
+
+            for (int c = 0; c < copyCount; c ++) {
+                const int *copy = copies[c];
+                const uint64_t occupied = occupancy(tTable, copy);
+                for (int i = 0; i < tTable.count; i ++) {
+                    if (tTable.colors[i] != mover || tTable.types[i] == pawn) continue;
+                    if (tTable.reduced && i && !inTriangle(copy[0])) continue;
+                    uint64_t sources = MagicBitboards::getAttacks(tTable.types[i], copy[i], occupied) & ~occupied;
+                    while (sources) {
+                        std::copy(copy, copy + tTable.count, after);
+                        after[i] = bitScanForward(sources);
+                        sources &= sources - 1;
+                        if (tTable.reduced && !inTriangle(after[0])) continue;
+                        const size_t parent = tTable.index(after, mover);
+                        if (tTable.wdl[parent] != UNKNOWN) continue;
+
+                        if (tTable.wdl[idx] < 0) tTable.wdl[parent] = 2;
+                        else if (!-- pending[parent]) tTable.wdl[parent] = bestExit[parent] == 0 ? 0 : -2;
+                        else continue;
+                        tTable.dtz[parent] = uint8_t(tTable.wdl[parent] ? ply + 1 : 0);
+                        if (tTable.wdl[parent]) next.push_back(parent);
+                    }
+                }
+            }
+        }
+        std::swap(level, next);
+    }
+
+    for (size_t idx = 0; idx < size; idx ++) {
+        if (tTable.wdl[idx] == UNKNOWN) tTable.wdl[idx] = 0;
+        if (tTable.hasPawns && tTable.wdl[idx] != INVALID && tTable.wdl[idx] != outcome[idx]) {
+            std::cout << tTable.name << ": the two passes of the solver disagree" << std::endl;
+            std::exit(1);
+        }
+    }
+}
+
+// -------------------------------------------------------------------------------------------------------
+// Syzygy writer
+// -------------------------------------------------------------------------------------------------------
+
+enum tbFlag {stmFlag = 1, mappedFlag = 2, winPliesFlag = 4, lossPliesFlag = 8, singleValueFlag = 128};
+
+uint64_t binomial(int tK, int tN)
+{
+    if (tK < 0 || tK > tN) return 0;
+    uint64_t result = 1;
+    for (int i = 1; i <= tK; i ++) result = result * uint64_t(tN - tK + i) / uint64_t(i);
+    return result;
+}
+
+inline int pieceCode(char tChar)
+{
+    const int type = int(pieceChars.find(char(std::toupper(tChar))));
+    return (std::islower(tChar) ? 8 : 0) + type - 1;
+}
+
+// Index of the positions of one sub-table, written from the format description: the leading group holds
+// the pawn, or three unique pieces, or the two kings, and goes to the a1-d1-d4 triangle or the a-d files.
+// Only one leading pawn is supported, which covers every table built here
+struct SubIndex {
+    int codes[MAX_MEN] {};
+    int count = 0;
+    bool hasPawns = false, unique = false;
+    int groupLen[MAX_MEN + 1] {};
+    uint64_t factor[MAX_MEN + 1] {};
+    uint64_t size = 0;
+    int kk[10][64] {};
+
+    SubIndex(const std::string &tPieces, int tOrder, bool tHasPawns) : count(int(tPieces.size())), hasPawns(tHasPawns) {
+        for (int i = 0; i < count; i ++) codes[i] = pieceCode(tPieces[i]);
+        for (char c : tPieces) unique |= c != 'K' && c != 'k' && std::count(tPieces.begin(), tPieces.end(), c) == 1;
+
+        const int leadLen = hasPawns ? 1 : unique ? 3 : 2;
+        int groups = 0;
+        groupLen[groups ++] = leadLen;
+        for (int i = leadLen; i < count; i ++) {
+            if (i > leadLen && codes[i] == codes[i - 1]) groupLen[groups - 1] ++;
+            else groupLen[groups ++] = 1;
+        }
+
+        uint64_t multiplier = 1;
+        int freeSquares = 64 - leadLen;
+        for (int k = 0, next = 1; k < groups; k ++) {
+            if (k == tOrder) {
+                factor[0] = multiplier;
+                multiplier *= hasPawns ? 6 : unique ? 31332 : 462;
+            }
+            else {
+                factor[next] = multiplier;
+                multiplier *= binomial(groupLen[next], freeSquares);
+                freeSquares -= groupLen[next ++];
+            }
+        }
+        size = multiplier;
+
+        // Two kings: first one in the triangle, placements in order, both on the diagonal last
+        if (!hasPawns && !unique) {
+            int code = 0;
+            std::vector<std::pair<int, int>> diagonal;
+            for (int t = 0; t < 10; t ++) {
+                const int first = lowerTriangle(t);
+                for (int second = a1; second <= h8; second ++) {
+                    if (std::abs((first & 7) - (second & 7)) <= 1 && std::abs((first >> 3) - (second >> 3)) <= 1) continue;
+                    if (onDiagonal(first) && above(second)) continue;
+                    if (onDiagonal(first) && onDiagonal(second)) diagonal.emplace_back(t, second);
+                    else kk[t][second] = code ++;
+                }
+            }
+            for (auto [t, second] : diagonal) kk[t][second] = code ++;
+        }
+    }
+
+    static bool onDiagonal(int tSquare) {return (tSquare >> 3) == (tSquare & 7);}
+    static bool above(int tSquare) {return (tSquare >> 3) > (tSquare & 7);}
+
+    // Triangle squares numbered below the diagonal first, b1 c1 d1 c2 d2 d3, then a1 b2 c3 d4
+    static int lowerTriangle(int tIndex) {
+        static constexpr int squares[10] = {b1, c1, d1, c2, d2, d3, a1, b2, c3, d4};
+        return squares[tIndex];
+    }
+    static int triangleIndex(int tSquare) {
+        for (int i = 0; i < 10; i ++) if (lowerTriangle(i) == tSquare) return i;
+        return -1;
+    }
+    // Squares strictly below the diagonal numbered 0..27 rank by rank
+    static int belowIndex(int tSquare) {
+        int idx = 0;
+        for (int square = a1; square < tSquare; square ++) idx += (square >> 3) < (square & 7);
+        return idx;
+    }
+
+    uint64_t encode(const Man *tMen, int &outFile) const {
+        int squares[MAX_MEN];
+        bool used[MAX_MEN] {};
+        for (int k = 0; k < count; k ++)
+            for (int i = 0; i < count; i ++)
+                if (!used[i] && (tMen[i].color * 8 + tMen[i].type - 1) == codes[k]) {
+                    used[i] = true;
+                    squares[k] = tMen[i].square;
+                    break;
+                }
+
+        auto apply = [&](int tSymmetry) {for (int i = 0; i < count; i ++) squares[i] = transform(tSymmetry, squares[i]);};
+        if ((squares[0] & 7) > 3) apply(1);
+        outFile = hasPawns ? squares[0] & 7 : 0;
+
+        uint64_t lead;
+        if (hasPawns) lead = uint64_t((squares[0] >> 3) - 1);
+        else {
+            if ((squares[0] >> 3) > 3) apply(2);
+            for (int i = 0; i < groupLen[0]; i ++) {
+                if (onDiagonal(squares[i])) continue;
+                if (above(squares[i])) apply(4);
+                break;
+            }
+            const int s0 = squares[0], s1 = squares[1], s2 = squares[2];
+            if (!unique) lead = uint64_t(kk[triangleIndex(s0)][s1]);
+            else {
+                const int a1 = s1 > s0, a2 = (s2 > s0) + (s2 > s1);
+                if (!onDiagonal(s0))
+                    lead = (uint64_t(triangleIndex(s0)) * 63 + uint64_t(s1 - a1)) * 62 + uint64_t(s2 - a2);
+                else if (!onDiagonal(s1))
+                    lead = 6 * 63 * 62 + (uint64_t(s0 >> 3) * 28 + uint64_t(belowIndex(s1))) * 62 + uint64_t(s2 - a2);
+                else if (!onDiagonal(s2))
+                    lead = 6 * 63 * 62 + 4 * 28 * 62 + uint64_t(s0 >> 3) * 7 * 28 + uint64_t((s1 >> 3) - a1) * 28
+                         + uint64_t(belowIndex(s2));
+                else
+                    lead = 6 * 63 * 62 + 4 * 28 * 62 + 4 * 7 * 28 + uint64_t(s0 >> 3) * 7 * 6
+                         + uint64_t((s1 >> 3) - a1) * 6 + uint64_t((s2 >> 3) - a2);
+            }
+        }
+
+        uint64_t idx = lead * factor[0];
+        for (int g = 1, start = groupLen[0]; groupLen[g]; start += groupLen[g ++]) {
+            std::sort(squares + start, squares + start + groupLen[g]);
+            uint64_t n = 0;
+            for (int i = 0; i < groupLen[g]; i ++) {
+                const int sq = squares[start + i];
+                const int below = int(std::count_if(squares, squares + start, [&](int s) {return s < sq;}));
+                n += binomial(i + 1, sq - below);
+            }
+            idx += n * factor[g];
+        }
+        return idx;
+    }
+};
+
+// Re-Pair compression of one sub-table followed by a canonical Huffman code, laid out in blocks
+struct Compressed {
+    uint8_t flags = 0;
+    std::vector<uint8_t> header, sparse, blockLength, data;
+};
+
+void putLE(std::vector<uint8_t> &tOut, uint64_t tValue, int tBytes)
+{
+    for (int i = 0; i < tBytes; i ++) tOut.push_back(uint8_t(tValue >> (8 * i)));
+}
+
+Compressed compress(const std::vector<int> &tValues, uint8_t tFlags)
+{
+    Compressed out;
+    out.flags = tFlags;
+    if (std::all_of(tValues.begin(), tValues.end(), [&](int v) {return v == tValues[0];})) {
+        out.flags |= singleValueFlag;
+        out.header.push_back(uint8_t(tValues[0]));
+        return out;
+    }
+
+    struct Symbol {int left, right, length;};
+    std::vector<Symbol> symbols;
+    std::vector<int> leafOf(256, -1), sequence;
+    for (int value : tValues) {
+        if (leafOf[value] < 0) {
+            leafOf[value] = int(symbols.size());
+            symbols.push_back({value, 0xfff, 1});
+        }
+        sequence.push_back(leafOf[value]);
+    }
+
+    // Replaces the most frequent pairs of adjacent symbols, a symbol takes part in one new pair per pass
+    for (int pass = 0; pass < 64 && symbols.size() < 4000; pass ++) {
+        std::unordered_map<uint32_t, uint32_t> counts;
+        for (size_t i = 0; i + 1 < sequence.size(); i ++) counts[uint32_t(sequence[i]) << 12 | uint32_t(sequence[i + 1])] ++;
+        std::vector<std::pair<uint32_t, uint32_t>> candidates;
+        for (auto [pair, count] : counts)
+            if (count >= 8 && symbols[pair >> 12].length + symbols[pair & 0xfff].length <= 256) candidates.emplace_back(count, pair);
+        std::sort(candidates.rbegin(), candidates.rend());
+
+        std::vector<int> rightOf(symbols.size(), -1), pairOf(symbols.size(), -1);
+        std::vector<bool> taken(symbols.size());
+        int added = 0;
+        for (auto [count, pair] : candidates) {
+            const int left = int(pair >> 12), right = int(pair & 0xfff);
+            if (taken[left] || taken[right] || added == 64 || symbols.size() >= 4000) continue;
+            taken[left] = taken[right] = true;
+            rightOf[left] = right;
+            pairOf[left] = int(symbols.size());
+            symbols.push_back({left, right, symbols[left].length + symbols[right].length});
+            added ++;
+        }
+        if (!added) break;
+
+        std::vector<int> paired;
+        for (size_t i = 0; i < sequence.size(); i ++) {
+            if (i + 1 < sequence.size() && rightOf[sequence[i]] == sequence[i + 1]) paired.push_back(pairOf[sequence[i ++]]);
+            else paired.push_back(sequence[i]);
+        }
+        sequence.swap(paired);
+    }
+
+    // Huffman code lengths of the symbols left in the sequence, capped to what the decoder refills
+    std::vector<uint64_t> frequency(symbols.size());
+    for (int sym : sequence) frequency[sym] ++;
+    std::vector<int> length(symbols.size());
+    for (int maxLength = 64; maxLength > 32; ) {
+        using Node = std::pair<uint64_t, int>;
+        std::priority_queue<Node, std::vector<Node>, std::greater<Node>> queue;
+        std::vector<int> parent;
+        std::vector<int> leafNode(symbols.size(), -1);
+        for (size_t sym = 0; sym < symbols.size(); sym ++)
+            if (frequency[sym]) {
+                leafNode[sym] = int(parent.size());
+                queue.emplace(frequency[sym], int(parent.size()));
+                parent.push_back(-1);
+            }
+        while (queue.size() > 1) {
+            const Node a = queue.top(); queue.pop();
+            const Node b = queue.top(); queue.pop();
+            parent[a.second] = parent[b.second] = int(parent.size());
+            queue.emplace(a.first + b.first, int(parent.size()));
+            parent.push_back(-1);
+        }
+        maxLength = 0;
+        for (size_t sym = 0; sym < symbols.size(); sym ++) {
+            length[sym] = 0;
+            for (int node = leafNode[sym]; node >= 0 && parent[node] >= 0; node = parent[node]) length[sym] ++;
+            if (leafNode[sym] >= 0) length[sym] = std::max(length[sym], 1);
+            maxLength = std::max(maxLength, length[sym]);
+        }
+        for (uint64_t &f : frequency) if (f) f = (f + 1) / 2;
+    }
+
+    // Longest codes first, as the decoder expects the symbols of each length to follow those of the longer ones
+    std::vector<int> order(symbols.size()), id(symbols.size());
+    for (size_t i = 0; i < order.size(); i ++) order[i] = int(i);
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+        return (length[a] ? 64 - length[a] : 99) < (length[b] ? 64 - length[b] : 99);
+    });
+    for (size_t i = 0; i < order.size(); i ++) id[order[i]] = int(i);
+
+    int minLength = 64, maxLength = 0;
+    for (int l : length) if (l) {minLength = std::min(minLength, l); maxLength = std::max(maxLength, l);}
+    std::vector<uint64_t> perLength(maxLength + 2), lowestSym(maxLength + 2), base(maxLength + 2);
+    for (int l : length) if (l) perLength[l] ++;
+    for (int l = maxLength; l >= minLength; l --) lowestSym[l] = l == maxLength ? 0 : lowestSym[l + 1] + perLength[l + 1];
+    for (int l = maxLength - 1; l >= minLength; l --) base[l] = (base[l + 1] + perLength[l + 1]) / 2;
+
+    // Blocks never split a symbol, the sparse index points at the middle of each span
+    constexpr int blockLog = 6, spanLog = 10;
+    constexpr size_t blockBits = size_t(8) << blockLog, maxBlockValues = 32768;
+    std::vector<uint64_t> blockStart;
+    size_t bits = blockBits, values = 0, position = 0;
+    for (int sym : sequence) {
+        if (bits + size_t(length[sym]) > blockBits || values + size_t(symbols[sym].length) > maxBlockValues) {
+            if (!blockStart.empty()) putLE(out.blockLength, values - 1, 2);
+            blockStart.push_back(position);
+            out.data.resize(out.data.size() + (size_t(1) << blockLog));
+            bits = values = 0;
+        }
+        const uint64_t code = base[length[sym]] + uint64_t(id[sym]) - lowestSym[length[sym]];
+        for (int b = length[sym] - 1; b >= 0; b --, bits ++)
+            if (code >> b & 1) out.data[out.data.size() - (size_t(1) << blockLog) + bits / 8] |= uint8_t(0x80 >> (bits % 8));
+        values += size_t(symbols[sym].length);
+        position += size_t(symbols[sym].length);
+    }
+    putLE(out.blockLength, values - 1, 2);
+
+    const uint64_t span = uint64_t(1) << spanLog;
+    for (uint64_t k = 0; k * span < tValues.size(); k ++) {
+        const uint64_t middle = k * span + span / 2;
+        const size_t block = size_t(std::upper_bound(blockStart.begin(), blockStart.end(), std::min<uint64_t>(middle, tValues.size() - 1))
+                                    - blockStart.begin() - 1);
+        putLE(out.sparse, block, 4);
+        putLE(out.sparse, middle - blockStart[block], 2);
+    }
+
+    out.header = {uint8_t(blockLog), uint8_t(spanLog), 0};
+    putLE(out.header, blockStart.size(), 4);
+    out.header.push_back(uint8_t(maxLength));
+    out.header.push_back(uint8_t(minLength));
+    for (int l = minLength; l <= maxLength; l ++) putLE(out.header, lowestSym[l], 2);
+    putLE(out.header, symbols.size(), 2);
+    for (int i : order) {
+        const int left = symbols[i].right == 0xfff ? symbols[i].left : id[symbols[i].left];
+        const int right = symbols[i].right == 0xfff ? 0xfff : id[symbols[i].right];
+        out.header.push_back(uint8_t(left));
+        out.header.push_back(uint8_t(left >> 8 | (right & 0xf) << 4));
+        out.header.push_back(uint8_t(right >> 4));
+    }
+    if (symbols.size() & 1) out.header.push_back(0);
+    return out;
+}
+
+// Piece order of the WDL sub-tables by side to move and of the DTZ one, group orders, and the side the
+// DTZ file stores. The choices vary on purpose, the probing code has to follow whatever a file says
+struct TableSpec {
+    std::string name;
+    std::string pieces[2];
+    int order[2];
+    int dtzSide;
+    bool dtzMapped;
+};
+
+void writeFile(const std::string &tPath, bool tDTZ, const TableSpec &tSpec, bool tHasPawns,
+               const std::vector<Compressed> &tSubs, const std::vector<uint8_t> &tMap)
+{
+    static constexpr uint8_t magics[2][4] = {{0x71, 0xe8, 0x23, 0x5d}, {0xd7, 0x66, 0x0c, 0xa5}};
+    const int files = tHasPawns ? 4 : 1;
+    const int side1 = tDTZ ? tSpec.dtzSide : 1, side0 = tDTZ ? tSpec.dtzSide : 0;
+
+    std::vector<uint8_t> out(magics[tDTZ], magics[tDTZ] + 4);
+    out.push_back(uint8_t((!tDTZ) | tHasPawns << 1));
+    for (int file = 0; file < files; file ++) {
+        out.push_back(uint8_t(tSpec.order[side0] | tSpec.order[side1] << 4));
+        for (size_t k = 0; k < tSpec.pieces[0].size(); k ++)
+            out.push_back(uint8_t(pieceCode(tSpec.pieces[side0][k]) | pieceCode(tSpec.pieces[side1][k]) << 4));
+    }
+    if (out.size() & 1) out.push_back(0);
+
+    for (const Compressed &sub : tSubs) {
+        out.push_back(sub.flags);
+        out.insert(out.end(), sub.header.begin(), sub.header.end());
+    }
+    if (tDTZ) {
+        out.insert(out.end(), tMap.begin(), tMap.end());
+        if (out.size() & 1) out.push_back(0);
+    }
+    for (const Compressed &sub : tSubs) out.insert(out.end(), sub.sparse.begin(), sub.sparse.end());
+    for (const Compressed &sub : tSubs) out.insert(out.end(), sub.blockLength.begin(), sub.blockLength.end());
+    for (const Compressed &sub : tSubs) {
+        out.resize((out.size() + 63) / 64 * 64);
+        out.insert(out.end(), sub.data.begin(), sub.data.end());
+    }
+
+    // Files end with a 16 byte checksum, not verified by the probing code
+    out.resize((out.size() + 63) / 64 * 64 + 16);
+    std::ofstream(tPath, std::ios::binary).write(reinterpret_cast<const char*>(out.data()), std::streamsize(out.size()));
+}
+
+// Writes the .rtbw and .rtbz files of a solved table, every placement of the men is encoded so that two
+// positions sharing an index through the symmetries must also share their value
+bool writeTable(const std::string &tDirectory, const TableSpec &tSpec, Solver &tSolver)
+{
+    const Table &table = tSolver.get(tSpec.name);
+    const int files = table.hasPawns ? 4 : 1;
+    const SubIndex wdlIndex[2] = {SubIndex(tSpec.pieces[0], tSpec.order[0], table.hasPawns),
+                                  SubIndex(tSpec.pieces[1], tSpec.order[1], table.hasPawns)};
+    const SubIndex &dtzIndex = wdlIndex[tSpec.dtzSide];
+
+    // Values not reached by any legal position are left for the compressor to choose
+    constexpr int unset = INT32_MIN;
+    std::vector<int> wdl[2][4], dtz[4];
+    for (int file = 0; file < files; file ++) {
+        for (int side = 0; side < 2; side ++) wdl[side][file].assign(wdlIndex[side].size, unset);
+        dtz[file].assign(dtzIndex.size, unset);
+    }
+
+    int squares[MAX_MEN] {};
+    size_t conflicts = 0;
+    for (int stm = white; stm <= black; stm ++)
+        for (uint64_t placement = 0; placement < (uint64_t(1) << (6 * table.count)); placement ++) {
+            for (int i = 0; i < table.count; i ++) squares[i] = int(placement >> (6 * i) & 63);
+            const size_t idx = table.index(squares, stm);
+            const int value = table.wdl[idx];
+            if (value == INVALID) continue;
+
+            Man men[MAX_MEN];
+            for (int i = 0; i < table.count; i ++) men[i] = {table.colors[i], table.types[i], squares[i]};
+            int file;
+            const uint64_t wdlIdx = wdlIndex[stm].encode(men, file);
+            int &stored = wdl[stm][file][wdlIdx];
+            conflicts += stored != unset && stored != value + 2;
+            stored = value + 2;
+
+            if (stm != tSpec.dtzSide || !value) continue;
+            int &storedDTZ = dtz[file][dtzIndex.encode(men, file)];
+            const int signedDTZ = value > 0 ? table.dtz[idx] : -table.dtz[idx];
+            conflicts += storedDTZ != unset && storedDTZ != signedDTZ;
+            storedDTZ = signedDTZ;
+        }
+    if (conflicts) {
+        std::cout << tSpec.name << ": " << conflicts << " indices shared by positions of different values" << std::endl;
+        return false;
+    }
+
+    auto fill = [&](std::vector<int> &tValues) {
+        int last = 0;
+        for (int value : tValues) if (value != unset) {last = value; break;}
+        for (int &value : tValues) value = value == unset ? last : (last = value);
+    };
+
+    std::vector<Compressed> subs;
+    for (int file = 0; file < files; file ++)
+        for (int side = 0; side < 2; side ++) {
+            fill(wdl[side][file]);
+            subs.push_back(compress(wdl[side][file], 0));
+        }
+    writeFile(tDirectory + "/" + tSpec.name + ".rtbw", false, tSpec, table.hasPawns, subs, {});
+
+    // DTZ values are stored in plies minus one, or by rank of frequency through the map of wins and losses
+    subs.clear();
+    std::vector<uint8_t> map;
+    for (int file = 0; file < files; file ++) {
+        fill(dtz[file]);
+        uint8_t flags = uint8_t(tSpec.dtzSide == black ? stmFlag : 0) | winPliesFlag | lossPliesFlag;
+        if (tSpec.dtzMapped) {
+            flags |= mappedFlag;
+            std::vector<int> ranks[2];
+            for (int sign = 0; sign < 2; sign ++) {
+                std::unordered_map<int, int> counts;
+                for (int value : dtz[file]) if ((value < 0) == bool(sign)) counts[std::abs(value) - 1] ++;
+                for (auto [value, count] : counts) ranks[sign].push_back(value);
+                std::sort(ranks[sign].begin(), ranks[sign].end(), [&](int a, int b) {
+                    return counts[a] != counts[b] ? counts[a] > counts[b] : a < b;
+                });
+                map.push_back(uint8_t(ranks[sign].size()));
+                map.insert(map.end(), ranks[sign].begin(), ranks[sign].end());
+            }
+            map.push_back(0);
+            map.push_back(0);
+            for (int &value : dtz[file]) {
+                const std::vector<int> &list = ranks[value < 0];
+                value = int(std::find(list.begin(), list.end(), std::abs(value) - 1) - list.begin());
+            }
+        }
+        else for (int &value : dtz[file]) value = std::abs(value) - 1;
+        subs.push_back(compress(dtz[file], flags));
+    }
+    writeFile(tDirectory + "/" + tSpec.name + ".rtbz", true, tSpec, table.hasPawns, subs, map);
+    return true;
+}
+
+// -------------------------------------------------------------------------------------------------------
+// Checks
+// -------------------------------------------------------------------------------------------------------
+
+int failures = 0;
+
+void fail(const std::string &tMessage)
+{
+    if (++ failures <= 20) std::cout << "FAIL " << tMessage << std::endl;
+}
+
+std::string fenOf(const Man *tMen, int tCount, int tSTM, const std::string &tRest = "- - 0 1")
+{
+    char board[64];
+    std::fill(board, board + 64, 0);
+    for (int i = 0; i < tCount; i ++) {
+        const char c = pieceChars[tMen[i].type];
+        board[tMen[i].square] = tMen[i].color == white ? c : char(std::tolower(c));
+    }
+    std::string fen;
+    for (int rank = 7; rank >= 0; rank --) {
+        int empty = 0;
+        for (int file = 0; file < 8; file ++) {
+            const char c = board[rank * 8 + file];
+            if (!c) {
+                empty ++;
+                continue;
+            }
+            if (empty) fen += char('0' + empty);
+            fen += c;
+            empty = 0;
+        }
+        if (empty) fen += char('0' + empty);
+        if (rank) fen += '/';
+    }
+    return fen + (tSTM == white ? " w " : " b ") + tRest;
+}
+
+int menOf(const Board &tBoard, Man *outMen)
+{
+    int count = 0;
+    for (int color = white; color <= black; color ++)
+        for (int type = pawn; type <= king; type ++)
+            for (uint64_t b = tBoard.getBitboard(color) & tBoard.getBitboard(type); b; b &= b - 1)
+                outMen[count ++] = {color, type, bitScanForward(b)};
+    return count;
+}
+
+int expectedDTZ(int tWDL, int tDTZ) {return tWDL > 0 ? tDTZ : tWDL < 0 ? -tDTZ : 0;}
+
+// Compares probes with the solver on every tStep-th position of a table, and on its colour-flipped copy
+void checkTable(Solver &tSolver, const std::string &tName, size_t tWDLStep, size_t tDTZStep)
+{
+    Tablebases &tablebases = Tablebases::getInstance();
+    const Table &table = tSolver.get(tName);
+    int squares[MAX_MEN], stm;
+    size_t checked = 0;
+
+    for (size_t idx = 0; idx < table.wdl.size(); idx += tWDLStep) {
+        if (table.wdl[idx] == INVALID) continue;
+        table.decode(idx, squares, stm);
+        Man men[MAX_MEN], flipped[MAX_MEN];
+        for (int i = 0; i < table.count; i ++) {
+            men[i] = {table.colors[i], table.types[i], squares[i]};
+            flipped[i] = {1 - table.colors[i], table.types[i], squares[i] ^ 56};
+        }
+        const bool probeDTZ = (idx / tWDLStep) % tDTZStep == 0;
+
+        for (const std::string &fen : {fenOf(men, table.count, stm), fenOf(flipped, table.count, 1 - stm)}) {
+            Board board(fen);
+            bool success;
+            const int wdl = tablebases.probeWDL(board, success);
+            if (!success || wdl != table.wdl[idx])
+                fail(fen + ": WDL " + std::to_string(wdl) + " expected " + std::to_string(table.wdl[idx]));
+            if (!probeDTZ) continue;
+            const int dtz = tablebases.probeDTZ(board, success);
+            const int expected = expectedDTZ(table.wdl[idx], table.dtz[idx]);
+            if (!success || dtz != expected)
+                fail(fen + ": DTZ " + std::to_string(dtz) + " expected " + std::to_string(expected));
+        }
+        checked ++;
+    }
+    std::cout << tName << ": " << checked << " positions probed" << std::endl;
+}
+
+struct KnownPosition {
+    const char *fen;
+    bool success;
+    int wdl, dtz;
+};
+
+// Results that follow from the rules or well known endgame theory, independent of the solver
+void checkKnownPositions()
+{
+    static const KnownPosition positions[] = {
+        {"R6k/8/6K1/8/8/8/8/8 b - - 0 1",      true,  -2, -1},  // mated
+        {"k7/8/1K6/8/8/8/8/7R w - - 0 1",      true,   2,  1},  // Rh8 mates
+        {"8/8/8/8/8/8/k7/R5K1 b - - 0 1",      true,   0,  0},  // Kxa1
+        {"7k/8/8/P7/8/8/8/7K w - - 0 1",       true,   2,  1},  // the king is outside the square
+        {"7k/8/8/P7/8/8/8/7K b - - 0 1",       true,  -2, -2},  // any king move, then a6
+        {"k7/8/8/P7/8/8/8/K7 w - - 0 1",       true,   0,  0},  // rook pawn, defending king in the corner
+        {"k7/8/8/P7/8/8/8/K7 b - - 0 1",       true,   0,  0},
+        {"k7/8/8/8/8/8/8/r2QK3 w - - 0 1",     true,   2,  1},  // Qxa1
+        {"k7/8/8/8/8/8/8/K2Q3r b - - 0 1",     true,   2,  1},  // Rxd1+ and KRvK
+        {"7k/8/8/8/8/8/8/k6K w - - 0 1",       false,  0,  0},  // two black kings, no table
+        // exd6 en passant queens unstoppably, the KPvKP table isn't needed to see it
+        {"8/8/8/3pP3/8/8/8/K6k w - d6 0 1",    true,   2,  1},
+        // without the en passant right the KPvKP table is needed, and missing
+        {"8/8/8/3pP3/8/8/8/K6k w - - 0 1",     false,  0,  0},
+    };
+
+    Tablebases &tablebases = Tablebases::getInstance();
+    for (const KnownPosition &position : positions) {
+        Board board(position.fen);
+        if (popCount(board.getBitboard(king) & board.getBitboard(white)) != 1) continue;
+        bool success;
+        const int wdl = tablebases.probeWDL(board, success);
+        if (success != position.success || (success && wdl != position.wdl))
+            fail(std::string(position.fen) + ": WDL " + (success ? std::to_string(wdl) : "failed"));
+        const int dtz = tablebases.probeDTZ(board, success);
+        if (success != position.success || (success && dtz != position.dtz))
+            fail(std::string(position.fen) + ": DTZ " + (success ? std::to_string(dtz) : "failed"));
+    }
+}
+
+// Outcome after a root move for the side playing it, in plies to zeroing as filterRootMoves counts them
+int rootDTZ(Solver &tSolver, Board &tBoard, Move tMove, const MoveGenerator &tGenerator)
+{
+    const bool zeroing = tMove.isCapture() || tBoard.searchPiece(tMove.from()) == pawn;
+    tBoard.makeMove(tMove);
+    Man men[MAX_MEN];
+    const int count = menOf(tBoard, men);
+    int dtz;
+    const int wdl = -tSolver.probe(men, count, tBoard.getSideToMove(), &dtz);
+    MoveList replies;
+    tGenerator.legal(tBoard, replies);
+    tBoard.undoMove(tMove);
+    if (wdl == 0) return 0;
+    if (zeroing || (wdl > 0 && replies.empty())) return wdl > 0 ? 1 : -1;
+    return wdl > 0 ? dtz + 1 : -dtz - 1;
+}
+
+// The root filter keeps every move preserving the outcome while the fifty-move rule can't interfere,
+// only the quickest conversions once it could
+void checkRootFilter(Solver &tSolver)
+{
+    const MoveGenerator generator;
+    const Table &table = tSolver.get("KRvK");
+    int squares[MAX_MEN], stm;
+
+    for (size_t idx = 0, checked = 0; idx < table.wdl.size() && checked < 200; idx += 37) {
+        if (table.wdl[idx] != 2 || table.dtz[idx] < 5) continue;
+        table.decode(idx, squares, stm);
+        Man men[MAX_MEN];
+        for (int i = 0; i < table.count; i ++) men[i] = {table.colors[i], table.types[i], squares[i]};
+
+        for (int hmc : {0, 90}) {
+            const std::string fen = fenOf(men, table.count, stm, "- - " + std::to_string(hmc) + " 60");
+            Board board(fen);
+            MoveList moves, expected;
+            generator.legal(board, moves);
+            int best = INT32_MAX;
+            for (Move move : moves) {
+                const int dtz = rootDTZ(tSolver, board, move, generator);
+                if (dtz > 0) best = std::min(best, dtz);
+            }
+            for (Move move : moves) {
+                const int dtz = rootDTZ(tSolver, board, move, generator);
+                if (dtz > 0 && (hmc == 0 || dtz == best)) expected.push(move);
+            }
+
+            MoveList filtered = moves;
+            if (!Tablebases::getInstance().filterRootMoves(board, false, filtered)) {
+                fail(fen + ": root filter failed");
+                continue;
+            }
+            bool same = filtered.size() == expected.size();
+            for (Move move : filtered) same &= std::find(expected.begin(), expected.end(), move) != expected.end();
+            if (!same) fail(fen + ": root filter kept " + std::to_string(filtered.size()) + " moves, expected "
+                            + std::to_string(expected.size()));
+        }
+        checked ++;
+    }
+}
+
+// First position of a table where the side to move holds the outcome with the fewest of its moves
+std::string criticalPosition(Solver &tSolver, const std::string &tName, int tSTM, int tWDL)
+{
+    const MoveGenerator generator;
+    const Table &table = tSolver.get(tName);
+    int squares[MAX_MEN], stm;
+    std::string best;
+    size_t bestShare = SIZE_MAX;
+
+    for (size_t idx = 0; idx < table.wdl.size(); idx ++) {
+        if (table.wdl[idx] != tWDL) continue;
+        table.decode(idx, squares, stm);
+        if (stm != tSTM) continue;
+        Man men[MAX_MEN];
+        for (int i = 0; i < table.count; i ++) men[i] = {table.colors[i], table.types[i], squares[i]};
+        const std::string fen = fenOf(men, table.count, stm);
+        Board board(fen);
+        MoveList moves;
+        generator.legal(board, moves);
+        size_t keeping = 0;
+        for (Move move : moves) keeping += rootDTZ(tSolver, board, move, generator) * tWDL > 0 || (!tWDL && !rootDTZ(tSolver, board, move, generator));
+        if (moves.size() >= 4 && keeping * 1000 / moves.size() < bestShare) {
+            bestShare = keeping * 1000 / moves.size();
+            best = fen;
+        }
+    }
+    return best;
+}
+
+// A real search from the engine, only the root moves keeping the tablebase outcome may come out of it
+void checkEngineMove(Solver &tSolver, const std::string &tDirectory, const std::string &tFEN, int tWDL)
+{
+    Engine engine;
+    engine.setSyzygyPath(tDirectory);
+    engine.setPos(tFEN);
+    SearchLimits limits;
+    limits.depth = 6;
+    limits.timestart = now();
+
+    std::ostringstream output;
+    std::streambuf *previous = std::cout.rdbuf(output.rdbuf());
+    engine.goSearch(limits);
+    engine.stopSearch();
+    std::cout.rdbuf(previous);
+
+    const std::string text = output.str();
+    const size_t at = text.rfind("bestmove ");
+    const std::string played = at == std::string::npos ? "" : text.substr(at + 9, text.find_first_of(" \n", at + 9) - at - 9);
+
+    std::cout << tFEN << ": bestmove " << played << std::endl;
+
+    const MoveGenerator generator;
+    Board board(tFEN);
+    MoveList moves;
+    generator.legal(board, moves);
+    for (Move move : moves) {
+        if (move.asString() != played) continue;
+        const int dtz = rootDTZ(tSolver, board, move, generator);
+        if ((tWDL > 0 && dtz <= 0) || (tWDL == 0 && dtz != 0))
+            fail(tFEN + ": the engine played " + played + " which changes the outcome");
+        return;
+    }
+    fail(tFEN + ": the engine played an illegal move \"" + played + "\"");
+}
+
+}
+
+int main()
+{
+    const std::filesystem::path directory = std::filesystem::temp_directory_path() / "engine_tablebase_test";
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory);
+
+    // Single leading pawn or unique pieces, as SubIndex supports, and the KK leading group with KNNvK
+    const std::vector<TableSpec> specs = {
+        {"KNvK",   {"KNk",  "kNK"},  {0, 0}, black, false},
+        {"KBvK",   {"KBk",  "KBk"},  {0, 0}, white, false},
+        {"KRvK",   {"KRk",  "kRK"},  {0, 0}, white, false},
+        {"KQvK",   {"KQk",  "QkK"},  {0, 0}, black, true},
+        {"KPvK",   {"PKk",  "PkK"},  {0, 0}, white, false},
+        {"KQvKR",  {"QrKk", "KkQr"}, {1, 0}, black, true},
+        {"KNNvK",  {"KkNN", "KkNN"}, {0, 1}, white, true},
+    };
+
+    Solver solver;
+    TimePoint start = now();
+    for (const TableSpec &spec : specs) {
+        if (!writeTable(directory.string(), spec, solver)) return 1;
+    }
+    std::cout << "tables built in " << now() - start << " ms" << std::endl;
+
+    const int found = Tablebases::getInstance().init(directory.string());
+    if (found != int(specs.size())) fail("found " + std::to_string(found) + " tables");
+
+    start = now();
+    checkTable(solver, "KNvK", 1, 7);
+    checkTable(solver, "KBvK", 1, 7);
+    checkTable(solver, "KRvK", 1, 3);
+    checkTable(solver, "KQvK", 1, 3);
+    checkTable(solver, "KPvK", 1, 3);
+    checkTable(solver, "KQvKR", 13, 211);
+    checkTable(solver, "KNNvK", 13, 97);
+    checkKnownPositions();
+    checkRootFilter(solver);
+    std::cout << "probes checked in " << now() - start << " ms" << std::endl;
+
+    checkEngineMove(solver, directory.string(), criticalPosition(solver, "KRvK", white, 2), 2);
+    checkEngineMove(solver, directory.string(), criticalPosition(solver, "KPvK", black, 0), 0);
+
+    Tablebases::getInstance().init("");
+    std::filesystem::remove_all(directory);
+    std::cout << (failures ? std::to_string(failures) + " checks failed" : "all checks passed") << std::endl;
+    return failures ? 1 : 0;
+}
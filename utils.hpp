@@ -121,6 +121,28 @@ constexpr uint64_t cpyWrapSout (uint64_t bitBoard) {wrapSout(bitBoard); return b
 constexpr uint64_t cpyWrapEast (uint64_t bitBoard) {wrapEast(bitBoard); return bitBoard;}
 constexpr uint64_t cpyWrapWest (uint64_t bitBoard) {wrapWest(bitBoard); return bitBoard;}
 
+/**
+ * @brief Returns the upper 64 bits of the 128 bit product, maps a uniform key onto [0, range)
+ * 
+ * @param value Uniformly distributed 64 bit value (e.g. a Zobrist key)
+ * @param range Size of the target range
+ * @return uint64_t value * range / 2^64
+ */
+inline uint64_t mulHi64(uint64_t value, uint64_t range){
+#if defined (_MSC_VER)
+    return __umulh(value, range);
+#elif  defined (__GNUC__) || defined (__clang__)
+    __extension__ using uint128 = unsigned __int128;
+    return static_cast<uint64_t>((uint128(value) * range) >> 64);
+#else
+    const uint64_t aLo = uint32_t(value), aHi = value >> 32;
+    const uint64_t bLo = uint32_t(range), bHi = range >> 32;
+    const uint64_t mid = aHi * bLo + (aLo * bLo >> 32);
+    const uint64_t cross = uint32_t(mid) + aLo * bHi;
+    return aHi * bHi + (mid >> 32) + (cross >> 32);
+#endif
+}
+
 // Time variables
 using TimePoint = std::chrono::milliseconds::rep;  // A value in milliseconds
 static_assert(sizeof(TimePoint) == sizeof(int64_t), "TimePoint should be 64 bits");
@@ -137,6 +159,25 @@ struct SearchLimits
     uint64_t nodes = 0ULL;
     int depth = 0, movestogo = 0;
     TimePoint movetime = 0, timestart = 0;
-    TimePoint time[2], inc[2];
+    TimePoint time[2] = {0, 0}, inc[2] = {0, 0};
+};
+
+// Selective search knobs, all of them exposed as UCI options.
+// A depth limit of 0 turns the matching pruning off
+struct SearchParams
+{
+    int nmpMinDepth = 3;        // null move: shallowest depth it is tried at
+    int nmpBase = 3;            // null move: reduction is base + depth / divisor
+    int nmpDivisor = 4;
+    int lmrMinDepth = 3;        // late moves: shallowest depth they get reduced at
+    int lmrMinMoves = 3;        // late moves: moves searched at full depth first
+    int lmrBase = 75;           // late moves: reduction is (base + ln(depth) ln(moves) * 100 / divisor) / 100
+    int lmrDivisor = 225;
+    int rfpDepth = 7;           // reverse futility: deepest depth and margin per ply
+    int rfpMargin = 80;
+    int razorDepth = 2;         // razoring: deepest depth and margin per ply
+    int razorMargin = 250;
+    int futilityDepth = 5;      // futility: deepest depth and margin per ply
+    int futilityMargin = 100;
 };
 